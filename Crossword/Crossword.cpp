@@ -21,6 +21,7 @@ class Crossword : public Problem<char> {
  public:
   Crossword(Option option);
   void ShowSolution();
+  void FormatSolution(const char values[], size_t count, string *text);
 
  private:
   Variable<char> *v[6][4];
@@ -97,6 +98,16 @@ void Crossword::ShowSolution() {
   }
 }
 
+void Crossword::FormatSolution(const char values[], size_t count,
+                               string *text) {
+  for (int row = 0; row < 4; row++) {
+    for (int col = 0; col < 6; col++)
+      *text += v[col][row] ? values[v[col][row]->GetId()] : '.';
+    *text += '\n';
+  }
+  *text += '\n';
+}
+
 int main(int argc, char *argv[]) {
   Option option;
   option.GetOptions(argc, argv);
@@ -10,7 +10,9 @@ class Fiver : public Problem<bool> {
  public:
   Fiver(Option option, int size);
   void ShowSolution();
+  void FormatSolution(const bool values[], size_t count, string *text);
   long GetSolutionCost();
+  long GetCostLowerBound();
 
  private:
   int size;
@@ -52,6 +54,19 @@ void Fiver::ShowSolution() {
   printf("%d moves\n", moves);
 }
 
+void Fiver::FormatSolution(const bool values[], size_t count, string *text) {
+  int moves = 0;
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      bool value = values[v[x][y]->GetId()];
+      *text += value ? "1 " : "0 ";
+      moves += value;
+    }
+    *text += '\n';
+  }
+  *text += to_string(moves) + " moves\n\n";
+}
+
 long Fiver::GetSolutionCost() {
   int moves = 0;
   for (int y = 0; y < size; y++)
@@ -59,6 +74,14 @@ long Fiver::GetSolutionCost() {
   return moves;
 }
 
+// Moves that have been decided.
+long Fiver::GetCostLowerBound() {
+  int moves = 0;
+  for (int y = 0; y < size; y++)
+    for (int x = 0; x < size; x++) moves += v[x][y]->Is(true);
+  return moves;
+}
+
 int main(int argc, char *argv[]) {
   int size = 4;
 
@@ -10,6 +10,8 @@ class BooleanOr : public Constraint<bool> {
  public:
   BooleanOr(const vector<bool> is_positive);
   bool OnDecided(Variable<bool> *decided);
+  bool IsEntailed() const;
+  Constraint<bool> *Clone() const { return new BooleanOr(*this); }
 
  private:
   const vector<bool> is_positive;
@@ -52,4 +54,10 @@ bool BooleanOr::OnDecided(Variable<bool> *decided) {
   return undecided->Decide(target_value, this);
 }
 
+bool BooleanOr::IsEntailed() const {
+  for (size_t i = 0; i < variables.size(); i++)
+    if (variables[i]->Is(is_positive[i])) return true;
+  return false;
+}
+
 #endif
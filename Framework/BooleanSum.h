@@ -13,6 +13,7 @@ class BooleanSum : public Constraint<T> {
  public:
   BooleanSum(Relation relation, size_t target);
   bool Enforce() override;
+  Constraint<T> *Clone() const override { return new BooleanSum<T>(*this); }
 
  private:
   Relation relation;
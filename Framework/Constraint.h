@@ -3,6 +3,7 @@
 
 #include "Queue.h"
 
+#include <map>
 #include <set>
 #include <vector>
 using namespace std;
@@ -13,6 +14,19 @@ class Variable;
 template <class T>
 class Problem;
 
+//
+// A literal states that a variable is, or is not, a value.
+//
+template <class T>
+struct Literal {
+  Variable<T> *variable;
+  T value;
+  bool is;
+
+  bool IsTrue() const;
+  bool IsFalse() const;
+};
+
 //
 // A constraint is about the relation of a set of variables
 //
@@ -36,9 +50,59 @@ class Constraint : public QueueObject {
   virtual bool OnReduced(Variable<T> *reduced) { return true; }
   virtual bool Enforce() { return true; }
 
-  void ActivateVariables();
+  // Events of a variable that the constraint is notified of. OnDecided is
+  // called on DECIDED. OnReduced is called on REDUCED, or only when the
+  // bounds of the domain change on BOUNDS.
+  enum Event { DECIDED = 1, REDUCED = 2, BOUNDS = 4 };
+  virtual int GetEvents(const Variable<T> *variable) const { return DECIDED; }
+
+  // Cost classes of Enforce. Active constraints of a cheaper class are
+  // enforced first, so they may find a conflict before costly work is done.
+  enum Cost { CHEAP, LINEAR, EXPENSIVE, NUM_COSTS };
+  virtual Cost GetCost() const { return LINEAR; }
+
+  // Explain a literal that the constraint has made true by the literals that
+  // implied it. False is returned if the constraint cannot explain it, and
+  // then all earlier updates of its variables are taken as the reason.
+  virtual bool Explain(const Literal<T> &literal,
+                       vector<Literal<T>> *reason) const {
+    return false;
+  }
+
+  // Explain why the constraint failed by literals that cannot be all true.
+  // False is returned if the constraint cannot explain it.
+  virtual bool ExplainConflict(vector<Literal<T>> *reason) const {
+    return false;
+  }
+
+  // Make a copy of the constraint for a replica of the problem.
+  // NULL is returned if the constraint cannot be copied.
+  virtual Constraint<T> *Clone() const { return NULL; }
+
+  // Replace the variables with their copies in a replica of the problem.
+  void ReplaceVariables(const map<Variable<T> *, Variable<T> *> &copies);
+  const vector<Variable<T> *> &GetVariables() const { return variables; }
+
+  // Mark the variables for singleton arc consistency to revise.
+  virtual void ActivateVariables();
   void GetDecidedValues(set<T> *values);
 
+  // Report to the problem that the constraint cannot be met.
+  void ReportConflict();
+
+  // Is more than one variable of the constraint undecided?
+  bool IsOpen() const;
+
+  // Is the constraint met by any values of its undecided variables? It then
+  // no longer connects them when solutions are counted.
+  virtual bool IsEntailed() const { return false; }
+
+  // Weight of the conflicts caused by the constraint.
+  float weight;
+
+  // Visited by the search of components of the problem if equal to its mark.
+  size_t mark;
+
   virtual void Show() const;
 
  protected:
@@ -53,7 +117,17 @@ class Constraint : public QueueObject {
 #include <stdarg.h>
 
 template <class T>
-Constraint<T>::Constraint() {}
+bool Literal<T>::IsTrue() const {
+  return is ? variable->Is(value) : !variable->GetDomain().Contains(value);
+}
+
+template <class T>
+bool Literal<T>::IsFalse() const {
+  return is ? !variable->GetDomain().Contains(value) : variable->Is(value);
+}
+
+template <class T>
+Constraint<T>::Constraint() : weight(1), mark(0) {}
 
 template <class T>
 void Constraint<T>::AddVariable(Variable<T> *variable) {
@@ -74,12 +148,23 @@ void Constraint<T>::AddVariable(size_t num_variables, ...) {
   va_end(ap);
 }
 
+template <class T>
+void Constraint<T>::ReplaceVariables(
+    const map<Variable<T> *, Variable<T> *> &copies) {
+  for (size_t i = 0; i < variables.size(); i++) {
+    variables[i] = copies.find(variables[i])->second;
+    variables[i]->AddConstraint(this);
+  }
+}
+
 template <class T>
 void Constraint<T>::SetProblem(Problem<T> *the_problem) {
   problem = the_problem;
+  mark = 0;
   for (size_t i = 0; i < variables.size(); i++) {
     Variable<T> *variable = variables[i];
     problem->AddVariable(variable);
+    variable->Watch(this, GetEvents(variable));
   }
 }
 
@@ -122,6 +207,19 @@ void Constraint<T>::GetDecidedValues(set<T> *values) {
       values->insert(variables[i]->GetValue(0));
 }
 
+template <class T>
+void Constraint<T>::ReportConflict() {
+  problem->ReportConflict(this);
+}
+
+template <class T>
+bool Constraint<T>::IsOpen() const {
+  size_t num_undecided = 0;
+  for (size_t i = 0; i < variables.size(); i++)
+    if (variables[i]->GetDomainSize() > 1 && ++num_undecided > 1) return true;
+  return false;
+}
+
 template <class T>
 void Constraint<T>::Show() const {
   printf("Constraint has %lu variables:\n", variables.size());
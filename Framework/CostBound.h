@@ -0,0 +1,56 @@
+#ifndef COST_BOUND_H
+#define COST_BOUND_H
+
+#include "Constraint.h"
+
+#include <limits.h>
+#include <atomic>
+#include <memory>
+using namespace std;
+
+//
+// CostBound: The cost of a solution is less than a bound, the cost of the
+// best solution found so far in optimization mode.
+//
+// The problem gives a lower bound of the costs of solutions in the current
+// domains, which is checked whenever a variable is decided. Copies of the
+// constraint in replicas share the bound, so a solution found by one of them
+// bounds the search of the others.
+//
+template <class T>
+class CostBound : public Constraint<T> {
+ public:
+  CostBound() : bound(new atomic<long>(LONG_MAX)) {}
+
+  // Lower the bound, unless a lower one has been set.
+  void SetBound(long bound_in);
+
+  bool Enforce();
+  // The bound depends on every variable. Activating them all for singleton arc
+  // consistency at each decision costs far more than the probes gain.
+  void ActivateVariables() {}
+  typename Constraint<T>::Cost GetCost() const {
+    return Constraint<T>::EXPENSIVE;
+  }
+  Constraint<T> *Clone() const { return new CostBound<T>(*this); }
+
+ private:
+  shared_ptr<atomic<long>> bound;
+};
+
+template <class T>
+void CostBound<T>::SetBound(long bound_in) {
+  long old_bound = *bound;
+  while (bound_in < old_bound &&
+         !bound->compare_exchange_weak(old_bound, bound_in)) {
+  }
+}
+
+template <class T>
+bool CostBound<T>::Enforce() {
+  long current_bound = *bound;
+  if (current_bound == LONG_MAX) return true;
+  return Constraint<T>::problem->GetLowerBound() < current_bound;
+}
+
+#endif
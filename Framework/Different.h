@@ -10,6 +10,8 @@ template <class T>
 class Different : public Constraint<T> {
  public:
   bool OnDecided(Variable<T> *decided);
+  bool Explain(const Literal<T> &literal, vector<Literal<T>> *reason) const;
+  Constraint<T> *Clone() const { return new Different<T>(*this); }
 
  private:
 };
@@ -33,4 +35,18 @@ bool Different<T>::OnDecided(Variable<T> *decided) {
   return true;
 }
 
+// A value is excluded because another variable is decided to it.
+template <class T>
+bool Different<T>::Explain(const Literal<T> &literal,
+                           vector<Literal<T>> *reason) const {
+  if (literal.is) return false;
+  for (auto *variable : Constraint<T>::variables) {
+    if (variable != literal.variable && variable->Is(literal.value)) {
+      reason->push_back(Literal<T>{variable, literal.value, true});
+      return true;
+    }
+  }
+  return false;
+}
+
 #endif
@@ -92,13 +92,6 @@ Domain<T>::Domain(T low, T high) {
   count = values.size();
 }
 
-template <>
-Domain<bool>::Domain(bool low, bool high) {
-  values.push_back(low);
-  if (low != high) values.push_back(high);
-  count = values.size();
-}
-
 template <class T>
 Domain<T>::Domain(const T values_in[]) {
   for (size_t i = 0; values_in[i]; i++) values.push_back(values_in[i]);
@@ -221,6 +214,156 @@ void Domain<T>::SetCount(size_t saved_count) {
   count = saved_count;
 }
 
+//
+// Specialization for bool domain, whose two values are faster to scan than
+// a vector
+//
+template <>
+class Domain<bool> {
+ public:
+  // Domain defined by bounds.
+  Domain(bool low, bool high);
+
+  // Domain defined by discrete values.
+  Domain(const bool value[], size_t count);
+
+  // Is the domain empty?
+  bool IsEmpty() const;
+
+  // Is there a single value in the domain?
+  bool IsSingle() const;
+
+  // Does the domain contain the given value?
+  bool Contains(bool value) const;
+
+  // Find in the domain the position of the given value.
+  // A return value of GetSize() means value not found.
+  size_t Find(bool value) const;
+
+  // Get the size of the domain.
+  size_t GetSize() const;
+
+  // Get the bounds of the domain.
+  // Result is undefined if domain is empty.
+  void GetBounds(bool &low, bool &high) const;
+
+  // Limit the domain to be within the given bounds.
+  // The new bounds may be tighter than the given bounds.
+  // The domain may become empty.
+  void LimitBounds(bool low, bool high);
+
+  // Get the i-th value.
+  bool GetValue(size_t i) const;
+  bool operator[](size_t i) const;
+
+  // Erase the i-th value.
+  // The previous (i+1)-th value, if exists, becomes the new i-th value.
+  void EraseValueAt(size_t i);
+
+  // Keep values that are in this domain or another domain.
+  void Union(const Domain &domain);
+
+  // Keep values that are in this domain and another domain.
+  void Intersect(const Domain &domain);
+
+  // Keep values that are in this domain but not in another domain.
+  void Differ(const Domain &domain);
+
+  // Get the count to be saved in a checkpoint.
+  size_t GetCount() const;
+
+  // Restore saved count from a checkpoint.
+  void SetCount(size_t saved_count);
+
+ private:
+  bool values[2];       // values in the domain
+  unsigned char count;  // number of values
+};
+
+Domain<bool>::Domain(bool low, bool high) : count(0) {
+  values[count++] = low;
+  if (low != high) values[count++] = high;
+}
+
+Domain<bool>::Domain(const bool values_in[], size_t count_in) : count(0) {
+  for (size_t i = 0; i < count_in && count < 2; i++)
+    if (!Contains(values_in[i])) values[count++] = values_in[i];
+}
+
+bool Domain<bool>::IsEmpty() const { return GetSize() == 0; }
+
+bool Domain<bool>::IsSingle() const { return GetSize() == 1; }
+
+bool Domain<bool>::Contains(bool value) const {
+  return Find(value) != GetSize();
+}
+
+size_t Domain<bool>::Find(bool value) const {
+  size_t i;
+  for (i = 0; i < GetSize(); i++)
+    if (values[i] == value) break;
+  return i;
+}
+
+size_t Domain<bool>::GetSize() const { return count; }
+
+void Domain<bool>::GetBounds(bool &low, bool &high) const {
+  low = high = values[0];
+  if (count == 2) {
+    low = false;
+    high = true;
+  }
+}
+
+void Domain<bool>::LimitBounds(bool low, bool high) {
+  for (size_t i = 0; i < count; i++) {
+    if (values[i] < low || values[i] > high) {
+      EraseValueAt(i);
+      i--;
+    }
+  }
+}
+
+bool Domain<bool>::GetValue(size_t i) const { return values[i]; }
+
+bool Domain<bool>::operator[](size_t i) const { return GetValue(i); }
+
+void Domain<bool>::EraseValueAt(size_t i) {
+  count--;
+
+  // swap the i-th and the last values
+  bool temp = values[i];
+  values[i] = values[count];
+  values[count] = temp;
+}
+
+void Domain<bool>::Union(const Domain &domain) {
+  for (size_t i = 0; i < domain.GetSize(); i++) {
+    bool value = domain.GetValue(i);
+    if (!Contains(value)) values[count++] = value;
+  }
+}
+
+void Domain<bool>::Intersect(const Domain &domain) {
+  for (size_t i = 0; i < GetSize(); i++) {
+    if (!domain.Contains(values[i])) {
+      EraseValueAt(i);
+      i--;
+    }
+  }
+}
+
+void Domain<bool>::Differ(const Domain &domain) {
+  for (size_t i = 0; i < domain.GetSize(); i++) {
+    size_t j = Find(domain[i]);
+    if (j != GetSize()) EraseValueAt(j);
+  }
+}
+
+size_t Domain<bool>::GetCount() const { return count; }
+
+void Domain<bool>::SetCount(size_t saved_count) { count = saved_count; }
+
 //
 // Specialization for char domain
 //
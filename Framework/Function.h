@@ -11,6 +11,9 @@ class Function : public Constraint<T> {
  public:
   Function(T target = 0);
   bool OnDecided(Variable<T> *decided);
+  bool Explain(const Literal<T> &literal, vector<Literal<T>> *reason) const;
+  bool ExplainConflict(vector<Literal<T>> *reason) const;
+  Constraint<T> *Clone() const { return new Function<T, F>(*this); }
 
  private:
   T target;
@@ -70,4 +73,26 @@ bool Function<T, F>::OnDecided(Variable<T> *decided) {
   }
 }
 
+// The values of a variable are excluded when all the other variables are
+// decided.
+template <class T, class F>
+bool Function<T, F>::Explain(const Literal<T> &literal,
+                             vector<Literal<T>> *reason) const {
+  for (auto *variable : Constraint<T>::variables) {
+    if (variable == literal.variable) continue;
+    if (variable->GetDomainSize() != 1) return false;
+    reason->push_back(Literal<T>{variable, variable->GetValue(0), true});
+  }
+  return true;
+}
+
+template <class T, class F>
+bool Function<T, F>::ExplainConflict(vector<Literal<T>> *reason) const {
+  for (auto *variable : Constraint<T>::variables) {
+    if (variable->GetDomainSize() != 1) return false;
+    reason->push_back(Literal<T>{variable, variable->GetValue(0), true});
+  }
+  return true;
+}
+
 #endif
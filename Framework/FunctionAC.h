@@ -15,6 +15,7 @@ class FunctionAC : public Constraint<T> {
  public:
   FunctionAC(T target);
   bool OnDecided(Variable<T> *decided);
+  Constraint<T> *Clone() const { return new FunctionAC<T, O, I>(*this); }
 
  private:
   T target;
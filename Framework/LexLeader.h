@@ -0,0 +1,107 @@
+#ifndef LEX_LEADER_H
+#define LEX_LEADER_H
+
+#include "Constraint.h"
+
+#include <map>
+#include <vector>
+using namespace std;
+
+//
+// LexLeader: The values of a sequence of variables are lexicographically no
+// greater than their image by a symmetry, so only the least of the solutions
+// that the symmetry maps to each other is kept.
+//
+// The symmetry maps each variable of the sequence to another one of it, and
+// each value to another value. Only the first position where the values and
+// their image may differ is propagated.
+//
+template <class T>
+class LexLeader : public Constraint<T> {
+ public:
+  // Map variables[i] to images[i], and each value to values[value], or to
+  // itself if it isn't in values.
+  LexLeader(const vector<Variable<T> *> &variables,
+            const vector<Variable<T> *> &images, const map<T, T> &values);
+
+  bool Enforce();
+  Constraint<T> *Clone() const { return new LexLeader<T>(*this); }
+
+ private:
+  T Map(T value) const;
+  bool Revise(Variable<T> *variable, Variable<T> *preimage);
+
+  vector<size_t> preimages;  // positions of the variables mapped to each one
+  map<T, T> values;
+};
+
+template <class T>
+LexLeader<T>::LexLeader(const vector<Variable<T> *> &variables,
+                        const vector<Variable<T> *> &images,
+                        const map<T, T> &values)
+    : preimages(variables.size()), values(values) {
+  map<Variable<T> *, size_t> positions;
+  for (size_t i = 0; i < variables.size(); i++) {
+    Constraint<T>::AddVariable(variables[i]);
+    positions[variables[i]] = i;
+  }
+  for (size_t i = 0; i < images.size(); i++)
+    preimages[positions[images[i]]] = i;
+}
+
+template <class T>
+T LexLeader<T>::Map(T value) const {
+  auto found = values.find(value);
+  return found == values.end() ? value : found->second;
+}
+
+template <class T>
+bool LexLeader<T>::Enforce() {
+  const vector<Variable<T> *> &variables = Constraint<T>::variables;
+  for (size_t i = 0; i < variables.size(); i++) {
+    Variable<T> *variable = variables[i];
+    Variable<T> *preimage = variables[preimages[i]];
+    if (!Revise(variable, preimage)) return false;
+    if (variable->GetDomainSize() > 1 || preimage->GetDomainSize() > 1 ||
+        variable->GetValue(0) != Map(preimage->GetValue(0)))
+      return true;
+  }
+  return true;
+}
+
+// The value of a variable is no greater than the image of the value of its
+// preimage.
+template <class T>
+bool LexLeader<T>::Revise(Variable<T> *variable, Variable<T> *preimage) {
+  vector<T> excluded;
+  if (variable == preimage) {
+    for (size_t i = 0; i < variable->GetDomainSize(); i++) {
+      T value = variable->GetValue(i);
+      if (Map(value) < value) excluded.push_back(value);
+    }
+    for (T value : excluded)
+      if (!variable->Exclude(value, this)) return false;
+    return true;
+  }
+
+  T high = Map(preimage->GetValue(0));
+  for (size_t i = 1; i < preimage->GetDomainSize(); i++)
+    high = max(high, Map(preimage->GetValue(i)));
+  for (size_t i = 0; i < variable->GetDomainSize(); i++)
+    if (variable->GetValue(i) > high) excluded.push_back(variable->GetValue(i));
+  for (T value : excluded)
+    if (!variable->Exclude(value, this)) return false;
+
+  T low = variable->GetValue(0);
+  for (size_t i = 1; i < variable->GetDomainSize(); i++)
+    low = min(low, variable->GetValue(i));
+  excluded.clear();
+  for (size_t i = 0; i < preimage->GetDomainSize(); i++)
+    if (Map(preimage->GetValue(i)) < low)
+      excluded.push_back(preimage->GetValue(i));
+  for (T value : excluded)
+    if (!preimage->Exclude(value, this)) return false;
+  return true;
+}
+
+#endif
@@ -0,0 +1,348 @@
+#ifndef NOGOOD_STORE_H
+#define NOGOOD_STORE_H
+
+#include "Constraint.h"
+
+#include <algorithm>
+#include <vector>
+using namespace std;
+
+//
+// NogoodStore: Learned nogoods, whose literals cannot be all true.
+//
+// The literals of all nogoods are kept in one array. A nogood watches its
+// first two literals, which are not both true unless it fails, so it is only
+// visited when one of them becomes true. Nogoods with a high LBD, the number
+// of decision levels of their literals when learned, and a low activity are
+// deleted periodically to bound the cost of propagation.
+//
+template <class T>
+class NogoodStore : public Constraint<T> {
+ public:
+  NogoodStore();
+
+  // Add a nogood. The literals of the latest updates are last.
+  // It is watched and propagated when the store is enforced.
+  void Add(const vector<Literal<T>> &literals, size_t lbd);
+
+  bool OnDecided(Variable<T> *decided) { return Propagate(decided); }
+  bool OnReduced(Variable<T> *reduced) { return Propagate(reduced); }
+  bool Enforce();
+  bool Explain(const Literal<T> &literal, vector<Literal<T>> *reason) const;
+  bool ExplainConflict(vector<Literal<T>> *reason) const;
+  int GetEvents(const Variable<T> *variable) const {
+    return Constraint<T>::DECIDED | Constraint<T>::REDUCED;
+  }
+  typename Constraint<T>::Cost GetCost() const { return Constraint<T>::CHEAP; }
+  // Nogoods are implied by the other constraints, so they don't make
+  // variables depend on each other.
+  bool IsEntailed() const { return true; }
+
+  size_t GetNumDeleted() const { return num_deleted; }
+
+ private:
+  struct Nogood {
+    size_t begin;  // of the literals
+    size_t size;
+    size_t lbd;
+    float activity;
+  };
+  static const size_t NONE = (size_t)-1;
+
+  bool Propagate(Variable<T> *variable);
+  bool Visit(Variable<T> *variable);
+  void Attach(size_t index);
+  bool Check(size_t index);
+  bool Falsify(size_t index);
+  void Bump(size_t index);
+  bool IsLocked(size_t index) const;
+  void Reduce();
+
+  vector<Literal<T>> literals;
+  vector<Nogood> nogoods;
+  vector<vector<size_t>> watches;  // nogoods by variable id
+  vector<bool> registered;         // variables that notify the store by id
+  vector<size_t> added;            // nogoods to be attached
+  vector<Variable<T> *> pending;   // variables to be visited
+  bool propagating;
+  size_t conflict;  // nogood that failed
+  float bump;       // added to the activity of a nogood when it is used
+  size_t max_nogoods;
+  size_t num_deleted;
+};
+
+template <class T>
+const size_t NogoodStore<T>::NONE;
+
+template <class T>
+NogoodStore<T>::NogoodStore()
+    : propagating(false),
+      conflict(NONE),
+      bump(1),
+      max_nogoods(2000),
+      num_deleted(0) {}
+
+template <class T>
+void NogoodStore<T>::Add(const vector<Literal<T>> &nogood, size_t lbd) {
+  nogoods.push_back(Nogood{literals.size(), nogood.size(), lbd, 0});
+  literals.insert(literals.end(), nogood.begin(), nogood.end());
+  added.push_back(nogoods.size() - 1);
+
+  for (const auto &literal : nogood) {
+    Variable<T> *variable = literal.variable;
+    size_t id = variable->GetId();
+    if (id >= watches.size()) {
+      watches.resize(id + 1);
+      registered.resize(id + 1, false);
+    }
+    if (!registered[id]) {
+      registered[id] = true;
+      Constraint<T>::variables.push_back(variable);
+      variable->Watch(this, GetEvents(variable));
+    }
+  }
+}
+
+// Variables changed by the store's own propagation notify it again, so they
+// are queued instead of visited while watches are being moved.
+template <class T>
+bool NogoodStore<T>::Propagate(Variable<T> *variable) {
+  pending.push_back(variable);
+  if (propagating) return true;
+  propagating = true;
+  bool consistent = true;
+  while (consistent && !pending.empty()) {
+    Variable<T> *next = pending.back();
+    pending.pop_back();
+    consistent = Visit(next);
+  }
+  pending.clear();
+  propagating = false;
+  return consistent;
+}
+
+// Visit the nogoods that watch a literal of a variable that may have become
+// true, and watch another literal that is not true instead.
+template <class T>
+bool NogoodStore<T>::Visit(Variable<T> *variable) {
+  vector<size_t> &list = watches[variable->GetId()];
+  size_t kept = 0;
+  size_t i = 0;
+  bool consistent = true;
+  for (; i < list.size() && consistent; i++) {
+    size_t index = list[i];
+    const Nogood &nogood = nogoods[index];
+    Literal<T> *nogood_literals = &literals[nogood.begin];
+    if (nogood.size == 1) {
+      list[kept++] = index;
+      if (nogood_literals[0].IsTrue()) {
+        conflict = index;
+        consistent = false;
+      }
+      continue;
+    }
+
+    // The watched literal of the variable is made the second one.
+    Literal<T> &first = nogood_literals[0];
+    Literal<T> &second = nogood_literals[1];
+    if (second.variable != variable ||
+        (first.variable == variable && first.IsTrue()))
+      swap(first, second);
+    if (!second.IsTrue()) {
+      list[kept++] = index;
+      continue;
+    }
+
+    size_t k = 2;
+    while (k < nogood.size && nogood_literals[k].IsTrue()) k++;
+    if (k < nogood.size) {
+      swap(second, nogood_literals[k]);
+      if (second.variable == variable || first.variable == variable)
+        list[kept++] = index;
+      if (second.variable != variable && second.variable != first.variable)
+        watches[second.variable->GetId()].push_back(index);
+      continue;
+    }
+
+    // All literals but the first one are true.
+    list[kept++] = index;
+    if (first.IsFalse()) continue;
+    Bump(index);
+    if (first.IsTrue()) {
+      conflict = index;
+      consistent = false;
+    } else {
+      consistent = Falsify(index);
+    }
+  }
+  for (; i < list.size(); i++) list[kept++] = list[i];
+  list.resize(kept);
+  return consistent;
+}
+
+// Attach the added nogoods before any of them propagates.
+template <class T>
+bool NogoodStore<T>::Enforce() {
+  for (size_t index : added) Attach(index);
+  bool consistent = true;
+  for (size_t i = 0; i < added.size() && consistent; i++)
+    consistent = Check(added[i]);
+  added.clear();
+  if (consistent && nogoods.size() >= max_nogoods) Reduce();
+  return consistent;
+}
+
+// Watch literals that are not true, or else the latest ones.
+template <class T>
+void NogoodStore<T>::Attach(size_t index) {
+  const Nogood &nogood = nogoods[index];
+  Literal<T> *nogood_literals = &literals[nogood.begin];
+  size_t num_watched = min(nogood.size, (size_t)2);
+  size_t latest = nogood.size - 1;
+  for (size_t w = 0; w < num_watched; w++) {
+    size_t k = w;
+    while (k < nogood.size && nogood_literals[k].IsTrue()) k++;
+    if (k == nogood.size) k = latest--;
+    swap(nogood_literals[w], nogood_literals[k]);
+    if (w == 0 || nogood_literals[1].variable != nogood_literals[0].variable)
+      watches[nogood_literals[w].variable->GetId()].push_back(index);
+  }
+}
+
+// Propagate a nogood that has just been attached.
+template <class T>
+bool NogoodStore<T>::Check(size_t index) {
+  const Nogood &nogood = nogoods[index];
+  const Literal<T> *nogood_literals = &literals[nogood.begin];
+  if (nogood.size == 0) {
+    conflict = index;
+    return false;
+  }
+
+  const Literal<T> &first = nogood_literals[0];
+  if (first.IsFalse()) return true;
+  if (nogood.size > 1 && !nogood_literals[1].IsTrue()) return true;
+  Bump(index);
+  if (first.IsTrue()) {
+    conflict = index;
+    return false;
+  }
+  return Falsify(index);
+}
+
+// Make the first literal of a nogood false.
+template <class T>
+bool NogoodStore<T>::Falsify(size_t index) {
+  const Literal<T> &first = literals[nogoods[index].begin];
+  if (first.is)
+    return first.variable->Exclude(first.value, NULL);
+  else
+    return first.variable->Decide(first.value, NULL);
+}
+
+// Activities decay by growing the bump as in WeighConflict of Problem.
+template <class T>
+void NogoodStore<T>::Bump(size_t index) {
+  nogoods[index].activity += bump;
+  bump /= 0.999;
+  if (bump > 1e20) {
+    for (auto &nogood : nogoods) nogood.activity *= 1e-20;
+    bump *= 1e-20;
+  }
+}
+
+// A literal is made false by a nogood whose first or second watched literal
+// is its negation, when the other literals are true.
+template <class T>
+bool NogoodStore<T>::Explain(const Literal<T> &literal,
+                             vector<Literal<T>> *reason) const {
+  size_t id = literal.variable->GetId();
+  if (id >= watches.size()) return false;
+  for (size_t index : watches[id]) {
+    const Nogood &nogood = nogoods[index];
+    const Literal<T> *nogood_literals = &literals[nogood.begin];
+    for (size_t w = 0; w < min(nogood.size, (size_t)2); w++) {
+      const Literal<T> &watched = nogood_literals[w];
+      if (watched.variable != literal.variable ||
+          watched.value != literal.value || watched.is == literal.is)
+        continue;
+      size_t k = 0;
+      while (k < nogood.size && (k == w || nogood_literals[k].IsTrue())) k++;
+      if (k < nogood.size) continue;
+      for (k = 0; k < nogood.size; k++)
+        if (k != w) reason->push_back(nogood_literals[k]);
+      return true;
+    }
+  }
+  return false;
+}
+
+template <class T>
+bool NogoodStore<T>::ExplainConflict(vector<Literal<T>> *reason) const {
+  if (conflict == NONE) return false;
+  const Nogood &nogood = nogoods[conflict];
+  reason->insert(reason->end(), literals.begin() + nogood.begin,
+                 literals.begin() + nogood.begin + nogood.size);
+  return true;
+}
+
+// Is a nogood the reason of a literal, i.e. one literal is false and the
+// others are true?
+template <class T>
+bool NogoodStore<T>::IsLocked(size_t index) const {
+  const Nogood &nogood = nogoods[index];
+  size_t num_false = 0;
+  for (size_t k = 0; k < nogood.size; k++) {
+    const Literal<T> &literal = literals[nogood.begin + k];
+    if (literal.IsFalse()) {
+      if (++num_false > 1) return false;
+    } else if (!literal.IsTrue()) {
+      return false;
+    }
+  }
+  return num_false == 1;
+}
+
+// Delete the worse half of the nogoods by LBD and activity. Nogoods with an
+// LBD of 2 or less, and those that are reasons of literals, are kept.
+template <class T>
+void NogoodStore<T>::Reduce() {
+  vector<size_t> candidates;
+  for (size_t i = 0; i < nogoods.size(); i++)
+    if (nogoods[i].lbd > 2 && !IsLocked(i)) candidates.push_back(i);
+  sort(candidates.begin(), candidates.end(), [this](size_t i, size_t j) {
+    if (nogoods[i].lbd != nogoods[j].lbd)
+      return nogoods[i].lbd > nogoods[j].lbd;
+    return nogoods[i].activity < nogoods[j].activity;
+  });
+  vector<bool> deleted(nogoods.size(), false);
+  for (size_t i = 0; i < candidates.size() / 2; i++)
+    deleted[candidates[i]] = true;
+
+  // Compact the literals and watch the first two of each nogood again.
+  size_t num_nogoods = 0, num_literals = 0;
+  for (auto &list : watches) list.clear();
+  for (size_t i = 0; i < nogoods.size(); i++) {
+    if (deleted[i]) continue;
+    Nogood nogood = nogoods[i];
+    copy(literals.begin() + nogood.begin,
+         literals.begin() + nogood.begin + nogood.size,
+         literals.begin() + num_literals);
+    nogood.begin = num_literals;
+    num_literals += nogood.size;
+    nogoods[num_nogoods] = nogood;
+    for (size_t w = 0; w < min(nogood.size, (size_t)2); w++) {
+      Variable<T> *variable = literals[nogood.begin + w].variable;
+      if (w == 0 || variable != literals[nogood.begin].variable)
+        watches[variable->GetId()].push_back(num_nogoods);
+    }
+    num_nogoods++;
+  }
+  num_deleted += nogoods.size() - num_nogoods;
+  nogoods.resize(num_nogoods);
+  literals.resize(num_literals);
+  conflict = NONE;
+  max_nogoods += 300;
+}
+
+#endif
@@ -11,13 +11,36 @@ using namespace std;
 template <class T>
 class OneToOne : public Different<T> {
  public:
+  bool OnDecided(Variable<T> *decided);
   bool OnReduced(Variable<T> *reduced);
+  bool Enforce();
+  int GetEvents(const Variable<T> *variable) const {
+    return Constraint<T>::DECIDED | Constraint<T>::REDUCED;
+  }
+  typename Constraint<T>::Cost GetCost() const {
+    return Constraint<T>::EXPENSIVE;
+  }
+  Constraint<T> *Clone() const { return new OneToOne<T>(*this); }
 
  private:
 };
 
+// Look for values in a single domain after the propagation of cheaper
+// constraints.
+template <class T>
+bool OneToOne<T>::OnDecided(Variable<T> *decided) {
+  Constraint<T>::problem->ActivateConstraint(this);
+  return Different<T>::OnDecided(decided);
+}
+
 template <class T>
 bool OneToOne<T>::OnReduced(Variable<T> *reduced) {
+  Constraint<T>::problem->ActivateConstraint(this);
+  return true;
+}
+
+template <class T>
+bool OneToOne<T>::Enforce() {
   vector<Variable<T> *> &variables = Constraint<T>::variables;
   size_t num_variables = variables.size();
 
@@ -8,15 +8,48 @@
 
 struct Option {
   bool arc_consistency = false;
+  size_t backtrack_limit = 0;  // 0 for no limit
+  bool backjumping = false;
+  bool counting = false;
   bool debug = false;
+  bool decomposition = false;  // backjump over independent components
+  size_t discrepancies = 0;  // iterations of limited discrepancy search
+  bool heap = false;
+  bool incremental_sac = false;  // skip probes whose dependencies are unchanged
   bool interactive = false;
   bool learning = false;
+  size_t memory_limit = 0;  // kilo-bytes of the trail, 0 for no limit
+  float neighborhood_time = 0;  // seconds of large neighborhood search
+  size_t node_limit = 0;        // 0 for no limit
   size_t num_solutions = 2;
   bool optimize = false;
+  enum output_t {
+    OUTPUT_SHOW,    // ShowSolution
+    OUTPUT_TEXT,    // FormatSolution into a buffer
+    OUTPUT_BINARY,  // values by variable id, into the output file
+    OUTPUT_COUNT,   // the number of solutions only
+  };
+  output_t output = OUTPUT_SHOW;
+  const char *output_file = NULL;  // of text (or stdout) or binary output
+  size_t portfolio = 1;
+  bool phase_saving = false;
+  size_t probe_threads = 1;  // of singleton arc consistency
   size_t progress = 0;
   float decay = 0.99;
   size_t restart = INT_MAX;
-  enum sort_t { SORT_DISABLED, SORT_DOMAIN_SIZE, SORT_FAILURES, SORT_WEIGHT };
+  enum restart_strategy_t {
+    RESTART_GEOMETRIC,
+    RESTART_LUBY,
+    RESTART_INNER_OUTER,
+  };
+  restart_strategy_t restart_strategy = RESTART_GEOMETRIC;
+  enum sort_t {
+    SORT_DISABLED,
+    SORT_DOMAIN_SIZE,
+    SORT_FAILURES,
+    SORT_WEIGHT,
+    SORT_WEIGHTED_DEGREE,
+  };
   sort_t sort = SORT_DISABLED;
   enum sort_values_t {
     SORT_VALUES_DISABLED,
@@ -25,36 +58,120 @@ struct Option {
     SORT_VALUES_IN_CONSTRAINT,
   };
   sort_values_t sort_values = SORT_VALUES_DISABLED;
+  bool symmetry_breaking = false;  // post the symmetries of the problem
+  size_t threads = 1;
+  float cpu_limit = 0;   // seconds, 0 for no limit
+  float time_limit = 0;  // seconds of wall time, 0 for no limit
 
   void GetOptions(int argc, char *argv[]);
   void ShowOptions() const;
+  Option GetPortfolioMember(size_t index) const;
 };
 
 void Option::GetOptions(int argc, char *argv[]) {
   int c;
-  while ((c = getopt(argc, argv, "adln:op:r:s:v:y:")) != -1) {
+  while ((c = getopt(argc, argv,
+                     "A:aB:bcDdF:hIj:L:lM:N:n:O:oP:p:R:r:Ss:T:t:v:x:Yy:")) !=
+         -1) {
     switch (c) {
+      case 'A':
+        probe_threads = atoi(optarg);
+        break;
       case 'a':
         arc_consistency = !arc_consistency;
         break;
+      case 'B':
+        backtrack_limit = atol(optarg);
+        break;
+      case 'b':
+        backjumping = !backjumping;
+        break;
+      case 'c':
+        counting = !counting;
+        break;
+      case 'D':
+        decomposition = !decomposition;
+        break;
       case 'd':
         debug = !debug;
         break;
+      case 'F':
+        output_file = optarg;
+        break;
+      case 'h':
+        heap = !heap;
+        break;
+      case 'I':
+        incremental_sac = !incremental_sac;
+        break;
+      case 'j':
+        threads = atoi(optarg);
+        break;
+      case 'L':
+        discrepancies = atoi(optarg);
+        break;
       case 'l':
         learning = !learning;
         break;
+      case 'M':
+        memory_limit = atol(optarg);
+        break;
+      case 'N':
+        neighborhood_time = atof(optarg);
+        break;
       case 'n':
         num_solutions = atoi(optarg);
         break;
+      case 'O':
+        switch (optarg[0]) {
+          case 's':
+            output = OUTPUT_SHOW;
+            break;
+          case 't':
+            output = OUTPUT_TEXT;
+            break;
+          case 'b':
+            output = OUTPUT_BINARY;
+            break;
+          case 'c':
+            output = OUTPUT_COUNT;
+            break;
+          default:
+            printf("Invalid output option: %s\n", optarg);
+            exit(1);
+        }
+        break;
       case 'o':
         optimize = !optimize;
         break;
+      case 'P':
+        portfolio = atoi(optarg);
+        break;
       case 'p':
         progress = atoi(optarg);
         break;
+      case 'R':
+        switch (optarg[0]) {
+          case 'g':
+            restart_strategy = RESTART_GEOMETRIC;
+            break;
+          case 'l':
+            restart_strategy = RESTART_LUBY;
+            break;
+          case 'i':
+            restart_strategy = RESTART_INNER_OUTER;
+            break;
+          default:
+            printf("Invalid restart option: %s\n", optarg);
+            exit(1);
+        }
+        break;
       case 'r':
         restart = atoi(optarg);
         break;
+      case 'S':
+        phase_saving = !phase_saving;
+        break;
       case 's':
         switch (optarg[0]) {
           case 'd':
@@ -66,6 +183,9 @@ void Option::GetOptions(int argc, char *argv[]) {
           case 'w':
             sort = SORT_WEIGHT;
             break;
+          case 'c':
+            sort = SORT_WEIGHTED_DEGREE;
+            break;
           case 'D':
             sort = SORT_DISABLED;
             break;
@@ -74,6 +194,12 @@ void Option::GetOptions(int argc, char *argv[]) {
             exit(1);
         }
         break;
+      case 'T':
+        time_limit = atof(optarg);
+        break;
+      case 't':
+        cpu_limit = atof(optarg);
+        break;
       case 'v':
         switch (optarg[0]) {
           case 'a':
@@ -93,6 +219,12 @@ void Option::GetOptions(int argc, char *argv[]) {
             exit(1);
         }
         break;
+      case 'x':
+        node_limit = atol(optarg);
+        break;
+      case 'Y':
+        symmetry_breaking = !symmetry_breaking;
+        break;
       case 'y':
         decay = atof(optarg);
         break;
@@ -102,15 +234,63 @@ void Option::GetOptions(int argc, char *argv[]) {
 
 void Option::ShowOptions() const {
   printf("arc_consistency = %d\n", arc_consistency);
+  printf("backtrack_limit = %ld\n", backtrack_limit);
+  printf("backjumping = %d\n", backjumping);
+  printf("counting = %d\n", counting);
   printf("debug = %d\n", debug);
+  printf("decomposition = %d\n", decomposition);
+  printf("discrepancies = %ld\n", discrepancies);
+  printf("heap = %d\n", heap);
+  printf("incremental_sac = %d\n", incremental_sac);
   printf("interactive = %d\n", interactive);
   printf("learning = %d\n", learning);
+  printf("memory_limit = %ld\n", memory_limit);
+  printf("neighborhood_time = %f\n", neighborhood_time);
+  printf("node_limit = %ld\n", node_limit);
   printf("num_solutions = %ld\n", num_solutions);
   printf("optimize = %d\n", optimize);
+  printf("output = %d\n", output);
+  printf("output_file = %s\n", output_file ? output_file : "stdout");
+  printf("phase_saving = %d\n", phase_saving);
+  printf("portfolio = %ld\n", portfolio);
+  printf("probe_threads = %ld\n", probe_threads);
   printf("decay = %f\n", decay);
   printf("restart = %ld\n", restart);
+  printf("restart_strategy = %d\n", restart_strategy);
   printf("sort = %d\n", sort);
   printf("sort_values = %d\n", sort_values);
+  printf("symmetry_breaking = %d\n", symmetry_breaking);
+  printf("threads = %ld\n", threads);
+  printf("cpu_limit = %f\n", cpu_limit);
+  printf("time_limit = %f\n", time_limit);
+}
+
+// Options of the index-th member in a portfolio of solvers. The first member
+// uses the options as given and the others vary the search heuristics.
+Option Option::GetPortfolioMember(size_t index) const {
+  static const sort_t sorts[] = {SORT_DOMAIN_SIZE, SORT_FAILURES, SORT_WEIGHT};
+  static const sort_values_t sorts_values[] = {
+      SORT_VALUES_DESCENDING, SORT_VALUES_ASCENDING, SORT_VALUES_IN_CONSTRAINT,
+      SORT_VALUES_DISABLED};
+
+  Option member = *this;
+  member.portfolio = 1;
+  member.progress = 0;
+  member.threads = 1;
+  if (index == 0) return member;
+
+  member.sort = sorts[index % 3];
+  member.sort_values = sorts_values[(index / 3) % 4];
+  member.decay = (index % 2 ? 0.9 : 0.999);
+  if (index % 4 == 3) {
+    member.restart = 100 * index;
+    member.learning = true;
+    if (index % 8 == 7) {
+      member.restart_strategy = RESTART_LUBY;
+      member.phase_saving = true;
+    }
+  }
+  return member;
 }
 
 #endif
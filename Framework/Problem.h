@@ -3,10 +3,25 @@
 
 #include "Option.h"
 #include "Constraint.h"
-#include "Nogood.h"
+#include "CostBound.h"
+#include "LexLeader.h"
+#include "NogoodStore.h"
 #include "Queue.h"
+#include "SolutionSink.h"
+
+#include <assert.h>
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <thread>
 #include <vector>
 using namespace std;
 
@@ -22,50 +37,232 @@ template <class T>
 class Problem {
  public:
   Problem(Option option);
-  ~Problem();
+  virtual ~Problem();
+
+  // Outcome of Solve. LIMIT means no solution was found before a resource
+  // limit of the options was reached, and ERROR that the options can't be
+  // used with the problem.
+  enum Status { SAT, UNSAT, LIMIT, OPTIMAL, ERROR };
 
   double GetTimeUsage();    // in seconds
+  double GetWallTime();     // in seconds since the problem was created
   size_t GetMemoryUsage();  // in kilo-bytes
 
   void AddConstraint(size_t num_variables, ...);
   void AddConstraint(Constraint<T> *constraint);
   void ActivateConstraint(Constraint<T> *constraint);
   void AddVariable(Variable<T> *variable);
-  void Solve();
+  // Declare a symmetry of the solutions, which maps variables[i] to images[i]
+  // and each value to values[value], or to itself. The variables are in the
+  // same order for all symmetries. With symmetry breaking, only solutions
+  // that are lexicographically least in that order are searched.
+  void AddSymmetry(const vector<Variable<T> *> &variables,
+                   const vector<Variable<T> *> &images,
+                   const map<T, T> &values = map<T, T>());
+  Status Solve();
   virtual void ShowState(Variable<T> *current);
   virtual bool IsValidSolution() { return true; }
+  // Whether solutions of parts of the problem that share no constraints are
+  // independent. It isn't if IsValidSolution checks across such parts.
+  virtual bool IsDecomposable() const { return true; }
   virtual void ShowSolution();
+  // Format a solution of values by variable id for text output.
+  virtual void FormatSolution(const T values[], size_t count, string *text);
+  // Give solutions to a sink, which the problem deletes, instead of showing
+  // them. A sink is made from the options if none is set.
+  void SetSink(SolutionSink<T> *sink);
   virtual long GetSolutionCost();
+  // A lower bound of the costs of solutions in the current domains, which
+  // prunes the search in optimization mode. LONG_MIN if it is unknown.
+  virtual long GetCostLowerBound() { return LONG_MIN; }
+  // GetCostLowerBound of the model, which replicas ask of their master.
+  long GetLowerBound();
 
   bool CheckSolution(size_t v);
   void ProcessSolution();
+  bool IsReplica() const { return master != NULL; }
+  void ReportConflict(Constraint<T> *constraint);
 
   void IncrementCounter(size_t index, size_t inc = 1);
   virtual void ShowCounters();
 
  private:
+  Problem<T> *Replicate(Option option);
+  bool SolvePortfolio();
+  bool SolveInParallel();
+  bool EvaluateSolution(Problem<T> *replica, long *cost);
+  long GetReplicaLowerBound(Problem<T> *replica);
+  void LoadSolution(Problem<T> *replica, const vector<T> &values);
+  void ReportSolution();
+  bool OpenSink();
+  static void Format(void *problem, const T values[], size_t count,
+                     string *text);
+  void AcceptSolution(Problem<T> *replica);
+  bool Run();
+  bool SearchNeighborhoods();
+  bool CountAll();
+  size_t CountComponents(const vector<Variable<T> *> &scope, size_t level);
+  size_t CountComponent(const vector<Variable<T> *> &component, size_t level);
+  void GetComponents(const vector<Variable<T> *> &scope,
+                     vector<vector<Variable<T> *>> *components);
+  void GetComponentKey(const vector<Variable<T> *> &component,
+                       string *key);
+
+  typedef vector<pair<size_t, T>> Job;  // decisions as (variable id, value)
+  bool TakeJob(Job *job);
+  void FinishJob(Problem<T> *replica);
+  void ShareJobs();
+  bool Replay(const Job &job);
+  void Work();
   void OrderValues(Variable<T> *variable, T values[]) const;
   bool EnforceActiveConstraints(bool consistent);
   bool PropagateDecision(Variable<T> *variable);
+  void WeighConflict();
+  bool IsOverLimit();
+  void Decide(Variable<T> *variable, T value, size_t level);
+  void Exclude(Variable<T> *variable, T value, const vector<size_t> &levels);
+  void GetConflictLevels(size_t level, vector<size_t> *levels);
+  void GetComponentLevels(size_t level, vector<size_t> *levels) const;
+  static void MergeLevels(vector<size_t> *into, const vector<size_t> &levels);
   void Revise(Variable<T> *variable, size_t v);
+  size_t GetSizeOfOthers(Variable<T> *variable) const;
+  bool IsSupported(Variable<T> *variable, T value, size_t others);
+  void GetReducedDomains(Variable<T> *variable,
+                         vector<pair<Variable<T> *, vector<T>>> *domains);
   bool EnforceArcConsistency(size_t v);
+  bool CreateProbers();
+  void RunProber(size_t p);
+  bool ProbeInParallel(size_t v);
+  void Synchronize(size_t num_kept, size_t num_checkpoints);
+  void Probe(const vector<size_t> &ids, size_t num_decided,
+             size_t num_variables);
   bool Search(size_t v);
-  void LearnNewNogoods();
+  void LearnNogood();
+  void BoundCost();
+  void ShowGap() const;
+  void ScheduleRestart();
+  static size_t Luby(size_t i);
+  void SavePhase(Variable<T> *variable, T value);
   void Sort(size_t v);
+  static bool HasSmallerDomain(const Variable<T> *v1, const Variable<T> *v2);
+  static bool HasMoreFailures(const Variable<T> *v1, const Variable<T> *v2);
+  static bool HasSmallerWeight(const Variable<T> *v1, const Variable<T> *v2);
   void StartCheckpoint();
   void RestoreCheckpoint();
 
   vector<Variable<T> *> variables;
+  vector<Variable<T> *> decided;  // before the search, removed from variables
   vector<Constraint<T> *> constraints;
-  Queue<Constraint<T> *> active_constraints;
+  PriorityQueue<Constraint<T> *, Constraint<T>::NUM_COSTS> active_constraints;
+  Constraint<T> *conflict;   // first constraint that failed in propagation
+  NogoodStore<T> *nogoods;   // learned, or NULL before the first one
+  CostBound<T> *cost_bound;  // NULL if not in optimization mode
+  Variable<T> *wipeout;      // variable whose domain was emptied by probing
+  float conflict_weight;     // added to the weight of a conflict
+
+  Trail<T> trail;
+  VariableHeap<T> *heap;  // replaces the linear scan of Sort if enabled
+
+  // Restarts are scheduled in backtracks by option.restart_strategy.
+  size_t restart_unit;  // initial option.restart
+  size_t num_restarts;
+  double inner_restart;  // of the inner-outer strategy
+  double outer_restart;
+  vector<T> phases;     // last value decided by variable id
+  vector<bool> phased;  // whether a variable has a saved phase
+
+  // Replicas search on their own threads and report to the master problem.
+  Problem<T> *master;
+  vector<pair<Variable<T> *, Variable<T> *>> replicas;  // (original, copy)
+  atomic<bool> stopped;
+  atomic<bool> *stop;
+  atomic<bool> limit_reached;  // by the problem or its replicas
+  double start_time;           // wall time when the problem was created
+  size_t limit_checks;         // since the clocks were last read
+  size_t clock_stride;         // checks between readings of the clocks
+  double clock_time;           // wall time when the clocks were last read
+  mutex solution_lock;
+
+  struct Solution {
+    vector<T> values;
+    size_t search_count;
+    size_t backtrack_count;
+  };
+  vector<Solution> solutions;  // found by a replica
+
+  SolutionSink<T> *sink;       // NULL if solutions are shown
+  FILE *sink_file;             // opened for the sink, or NULL
+  unique_ptr<T[]> sink_values;  // by variable id
+  size_t num_sink_values;
+
+  // Parallel search shares subtrees as jobs among replicas.
+  mutex job_lock;
+  condition_variable job_ready;
+  deque<Job> jobs;
+  atomic<size_t> idle_workers;
+  Job job;  // being searched by a replica
+
+  // Limited discrepancy search counts the values tried after the first one
+  // of each frame on the search path. Value orders change between its
+  // iterations, so the solutions that they report are kept to skip them.
+  size_t max_discrepancies;          // of the paths searched by the iteration
+  bool pruned;                       // whether the iteration exceeded it
+  set<vector<T>> limited_solutions;  // values by variable id
+
+  // Counting multiplies the counts of components, which are cached by the
+  // domains of their variables and the other variables of their constraints.
+  unordered_map<string, size_t> component_counts;
+  vector<size_t> marks;  // of variables by id, visited if equal to mark
+  size_t mark;
+  size_t cache_hits;
+  bool count_overflow;  // counts that overflow are kept at SIZE_MAX
+
+  // Parallel SAC probes values on replicas, each on its own thread. They take
+  // the domains of the problem at each round and report the values that
+  // failed. A replica keeps a checkpoint for each checkpoint of the problem
+  // that it took domains in, while the problem hasn't restored it.
+  vector<Problem<T> *> probers;
+  vector<thread> prober_threads;
+  mutex probe_lock;
+  condition_variable probe_ready;     // a round is posted or probers stopped
+  condition_variable probe_done;      // all the probers finished the round
+  size_t probe_round;                 // number of rounds posted
+  size_t busy_probers;                // not done with the round
+  bool probers_stopped;
+  vector<vector<size_t>> probe_work;  // ids of variables, by prober
+  size_t probe_num_decided;           // variables of the search of the round
+  vector<size_t> probed_stamps;       // checkpoints that domains were taken in
+  size_t num_probed_kept;             // fewest of them open since the round
+  size_t num_taken;                   // checkpoints of a replica for them
+  struct FailedProbe {
+    size_t id;        // of the variable
+    T value;
+    size_t conflict;  // index of the constraint, or SIZE_MAX
+  };
+  vector<FailedProbe> failed;  // by the probes of a replica
 
-  typedef vector<pair<Variable<T> *, size_t>> Storage;
-  Storage storage;
+  // Incremental SAC keeps the probes that were consistent, with the values
+  // left in the domains that they reduced. A probe is made again only if one
+  // of those values, or a value of another variable, has been excluded since.
+  struct Support {
+    vector<pair<Variable<T> *, vector<T>>> domains;
+    size_t others;       // sum of the domain sizes of the variables not reduced
+    size_t num_decided;  // variables after the probe, with those of the path
+  };
+  vector<map<T, Support>> supports;  // of values by variable id
+  size_t support_level;  // of the decisions when SAC was last enforced
+  size_t cached_probe_count;
+
+  // Large neighborhood search fixes variables to the best solution found.
+  vector<T> incumbent;  // values by variable id
+  unsigned int seed;    // of the random neighborhoods
 
  protected:
   size_t num_solutions;
   size_t search_count;
   size_t backtrack_count;
+  size_t backjump_count;
+  size_t nogood_count;
 
   Option option;
 
@@ -78,32 +275,106 @@ class Problem {
   Counter counters[16];
 
   long min_cost;
+  long root_bound;  // lower bound of the cost before the search
 
-  struct Backtrack {
-    Backtrack(Variable<T> *variable, T *values, int size)
-        : variable(variable), values(values), size(size) {}
-
+  // A frame of the search stack tries values of a variable in order.
+  // Frames are reused so their value buffers are allocated only once.
+  struct Frame {
     Variable<T> *variable;
-    T *values;
+    unique_ptr<T[]> values;
+    size_t capacity = 0;
     int size;
-    int index = 0;
+    int index;
+    size_t discrepancies;  // of the search path above the frame
+    size_t v;
+    bool checkpoint;
+    bool is_deadend;
+    vector<size_t> conflict;  // levels that failed values depend on
+    vector<size_t> components;  // of the undecided variables by id
   };
-  vector<Backtrack> nogood;
+  vector<Frame> path;  // decisions on the current search path
+  size_t depth;        // number of frames in use
+  vector<size_t> jump_levels;  // levels that a returning node depends on
+  void PushFrame(size_t v);
+  size_t GetDiscrepancies() const;
+  bool IsNewSolution();
+  void GetValues(vector<T> *values) const;
 };
 
 #include <sys/time.h>
 
 template <class T>
 Problem<T>::Problem(Option option)
-    : num_solutions(0),
+    : conflict(NULL),
+      nogoods(NULL),
+      cost_bound(NULL),
+      wipeout(NULL),
+      conflict_weight(1),
+      heap(NULL),
+      restart_unit(option.restart),
+      num_restarts(0),
+      inner_restart(option.restart),
+      outer_restart(option.restart),
+      master(NULL),
+      stopped(false),
+      stop(&stopped),
+      limit_reached(false),
+      limit_checks(0),
+      clock_stride(1),
+      clock_time(0),
+      sink(NULL),
+      sink_file(NULL),
+      num_sink_values(0),
+      idle_workers(0),
+      max_discrepancies(SIZE_MAX),
+      pruned(false),
+      mark(0),
+      cache_hits(0),
+      count_overflow(false),
+      probe_round(0),
+      busy_probers(0),
+      probers_stopped(false),
+      probe_num_decided(0),
+      num_probed_kept(0),
+      num_taken(0),
+      support_level(0),
+      cached_probe_count(0),
+      seed(1),
+      num_solutions(0),
       search_count(0),
       backtrack_count(0),
+      backjump_count(0),
+      nogood_count(0),
       option(option),
-      min_cost(LONG_MAX) {}
+      min_cost(LONG_MAX),
+      root_bound(LONG_MIN),
+      depth(0) {
+  // Values pruned by the discrepancy limit, or fixed in a neighborhood, are
+  // not refuted, so they can't be learned from.
+  // Nogoods connect the variables that counting decomposes.
+  if (option.discrepancies || option.neighborhood_time > 0 || option.counting)
+    this->option.learning = false;
+  if (this->option.backjumping || this->option.learning) trail.EnableEvents();
+
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  start_time = now.tv_sec + now.tv_usec * 1e-6;
+}
 
 template <class T>
 Problem<T>::~Problem() {
+  delete heap;
+  delete sink;
+  if (sink_file) fclose(sink_file);
   for (auto *c : constraints) delete c;
+  for (auto &replica : replicas) delete replica.second;
+  {
+    lock_guard<mutex> guard(probe_lock);
+    probers_stopped = true;
+  }
+  probe_ready.notify_all();
+  for (auto &thread : prober_threads) thread.join();
+  for (auto *prober : probers) delete prober;
 }
 
 template <class T>
@@ -114,6 +385,13 @@ double Problem<T>::GetTimeUsage() {
          (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
 }
 
+template <class T>
+double Problem<T>::GetWallTime() {
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  return now.tv_sec + now.tv_usec * 1e-6 - start_time;
+}
+
 template <class T>
 size_t Problem<T>::GetMemoryUsage() {
   struct rusage usage;
@@ -127,9 +405,17 @@ void Problem<T>::AddConstraint(Constraint<T> *constraint) {
   constraint->SetProblem(this);
 }
 
+template <class T>
+void Problem<T>::AddSymmetry(const vector<Variable<T> *> &variables,
+                             const vector<Variable<T> *> &images,
+                             const map<T, T> &values) {
+  if (option.symmetry_breaking)
+    AddConstraint(new LexLeader<T>(variables, images, values));
+}
+
 template <class T>
 void Problem<T>::ActivateConstraint(Constraint<T> *constraint) {
-  active_constraints.Enqueue(constraint);
+  active_constraints.Enqueue(constraint, constraint->GetCost());
 }
 
 template <class T>
@@ -137,7 +423,7 @@ void Problem<T>::AddVariable(Variable<T> *variable) {
   if (variable->active) return;
   variable->active = true;
   variable->SetId(variables.size());
-  variable->SetStorage(&storage);
+  variable->SetTrail(&trail);
   variables.push_back(variable);
 }
 
@@ -169,21 +455,94 @@ void Problem<T>::OrderValues(Variable<T> *variable, T values[]) const {
       break;
     }
   }
+
+  // Try the value of the last decision first after a restart.
+  size_t id = variable->GetId();
+  if (option.phase_saving && id < phases.size() && phased[id]) {
+    T *phase = find(values, values + domain_size, phases[id]);
+    if (phase != values + domain_size) rotate(values, phase, phase + 1);
+  }
 }
 
 template <class T>
 bool Problem<T>::EnforceActiveConstraints(bool consistent) {
   while (!active_constraints.IsEmpty()) {
     Constraint<T> *constraint = active_constraints.Dequeue();
-    if (consistent) consistent = constraint->Enforce();
+    if (consistent) {
+      Constraint<T> *reason = trail.SetReason(constraint);
+      consistent = constraint->Enforce();
+      trail.SetReason(reason);
+      if (!consistent) ReportConflict(constraint);
+    }
   }
   return consistent;
 }
 
 template <class T>
 bool Problem<T>::PropagateDecision(Variable<T> *variable) {
+  conflict = NULL;
+  wipeout = NULL;
   bool consistent = variable->PropagateDecision(NULL);
-  return EnforceActiveConstraints(consistent);
+  consistent = EnforceActiveConstraints(consistent);
+  if (!consistent) WeighConflict();
+  return consistent;
+}
+
+// Remember the constraint that failed first, where a conflict was found
+// before it was propagated back through other constraints.
+template <class T>
+void Problem<T>::ReportConflict(Constraint<T> *constraint) {
+  if (!conflict) conflict = constraint;
+}
+
+// Increase the weight of the conflict. Later conflicts weigh more so that
+// earlier weights decay as in VSIDS.
+template <class T>
+void Problem<T>::WeighConflict() {
+  if (!conflict) return;
+  conflict->weight += conflict_weight;
+  conflict_weight /= option.decay;
+  if (conflict_weight > 1e20) {
+    for (auto *constraint : constraints) constraint->weight *= 1e-20;
+    conflict_weight *= 1e-20;
+  }
+}
+
+// Decide a value of a variable at a level of decisions.
+template <class T>
+void Problem<T>::Decide(Variable<T> *variable, T value, size_t level) {
+  trail.SetLevel(level);
+  Constraint<T> *reason = trail.SetReason(Trail<T>::DECISION);
+  variable->Decide(value);
+  trail.SetReason(reason);
+}
+
+// Exclude a value that failed because of decisions at the given levels.
+template <class T>
+void Problem<T>::Exclude(Variable<T> *variable, T value,
+                         const vector<size_t> &levels) {
+  if (option.backjumping) trail.SetExplanation(levels);
+  variable->Exclude(value);
+  trail.SetReason(NULL);
+}
+
+// Find the levels of decisions, other than the given one, that the last
+// failure depends on. Call it before the failed checkpoint is restored.
+template <class T>
+void Problem<T>::GetConflictLevels(size_t level, vector<size_t> *levels) {
+  levels->clear();
+  if (!option.backjumping) return;
+  trail.GetConflictLevels(conflict, wipeout, levels);
+  levels->erase(remove(levels->begin(), levels->end(), level), levels->end());
+}
+
+template <class T>
+void Problem<T>::MergeLevels(vector<size_t> *into,
+                             const vector<size_t> &levels) {
+  vector<size_t> merged;
+  set_union(into->begin(), into->end(), levels.begin(), levels.end(),
+            back_inserter(merged));
+  into->swap(merged);
 }
 
 template <class T>
@@ -191,11 +550,29 @@ void Problem<T>::Revise(Variable<T> *variable, size_t v) {
   size_t domain_size = variable->GetDomainSize();
   T values[domain_size];
   OrderValues(variable, values);
+  // Probes are decisions one level below the search.
+  size_t level = trail.GetLevel();
+  vector<size_t> levels;
+  // Only the variable is reduced while it is revised.
+  size_t others = option.incremental_sac ? GetSizeOfOthers(variable) : 0;
   for (size_t i = 0; i < domain_size; i++) {
+    // Values left unprobed are kept, which is sound.
+    if (*stop || IsOverLimit()) break;
+    if (option.incremental_sac && IsSupported(variable, values[i], others)) {
+      // The probe would leave the same domains. The variables before v are
+      // the decisions of the path.
+      size_t num_decided = supports[variable->GetId()][values[i]].num_decided;
+      variable->failures += (num_decided - v) / float(variables.size());
+      cached_probe_count++;
+      continue;
+    }
     StartCheckpoint();
 
-    variable->Decide(values[i]);
+    Decide(variable, values[i], level + 1);
     bool consistent = PropagateDecision(variable);
+    if (!consistent) GetConflictLevels(level + 1, &levels);
+    trail.SetLevel(level);
+    Support support;
     if (consistent) {
       DEBUG(printf("Variable %ld = %d is consistent\n", variable->GetId(),
                    values[i]));
@@ -204,18 +581,71 @@ void Problem<T>::Revise(Variable<T> *variable, size_t v) {
       for (size_t j = v; j < variables.size(); ++j)
         num_decided += (variables[j]->GetDomainSize() == 1);
       variable->failures += num_decided / float(variables.size());
+      support.num_decided = num_decided + v;
+      if (option.incremental_sac)
+        GetReducedDomains(variable, &support.domains);
     }
 
     RestoreCheckpoint();
+    if (consistent && option.incremental_sac) {
+      support.others = others;
+      for (const auto &domain : support.domains)
+        support.others -= domain.first->GetDomainSize();
+      supports[variable->GetId()][values[i]] = move(support);
+    }
 
     if (!consistent) {
       DEBUG(printf("Variable %ld = %d is inconsistent\n", variable->GetId(),
                    values[i]));
       DEBUG(ShowState(variable));
       variable->failures++;
-      variable->Exclude(values[i]);
+      Exclude(variable, values[i], levels);
     }
   }
+  if (heap) heap->Update(variable);
+}
+
+// Sum the domain sizes of the variables other than the given one.
+template <class T>
+size_t Problem<T>::GetSizeOfOthers(Variable<T> *variable) const {
+  size_t size = 0;
+  for (auto *other : variables)
+    if (other != variable) size += other->GetDomainSize();
+  return size;
+}
+
+// Whether a consistent probe of a value is kept. The domains that it left
+// are still a fixpoint of propagation within the current domains if no value
+// in them has been excluded since. Domains only shrink while SAC is
+// enforced, so the variables that it didn't reduce are unchanged if the sum
+// of their sizes is.
+template <class T>
+bool Problem<T>::IsSupported(Variable<T> *variable, T value, size_t others) {
+  const map<T, Support> &values = supports[variable->GetId()];
+  auto found = values.find(value);
+  if (found == values.end()) return false;
+  const Support &support = found->second;
+  for (const auto &domain : support.domains) {
+    for (T value : domain.second)
+      if (!domain.first->GetDomain().Contains(value)) return false;
+    others -= domain.first->GetDomainSize();
+  }
+  return others == support.others;
+}
+
+// Get the domains that a probe of a variable reduced, before its checkpoint
+// is restored.
+template <class T>
+void Problem<T>::GetReducedDomains(
+    Variable<T> *variable, vector<pair<Variable<T> *, vector<T>>> *domains) {
+  vector<Variable<T> *> reduced;
+  trail.GetSavedVariables(&reduced);
+  for (auto *other : reduced) {
+    if (other == variable) continue;
+    vector<T> values(other->GetDomainSize());
+    for (size_t i = 0; i < values.size(); i++) values[i] = other->GetValue(i);
+    domains->emplace_back(other, move(values));
+  }
 }
 
 template <class T>
@@ -224,6 +654,22 @@ bool Problem<T>::EnforceArcConsistency(size_t v) {
     Variable<T> *variable = variables[i];
     variable->failures *= option.decay;
   }
+  // Supports are kept only while domains shrink, from the node where SAC
+  // was last enforced down to its descendants. Any node after a backtrack or
+  // a restart is no deeper than that one.
+  if (option.incremental_sac) {
+    size_t level = trail.GetLevel();
+    if (level <= support_level) {
+      for (auto &values : supports) values.clear();
+      for (auto *variable : variables) {
+        size_t id = variable->GetId();
+        if (id >= supports.size()) supports.resize(id + 1);
+      }
+    }
+    support_level = level;
+  }
+  if (heap) heap->Rebuild();
+  if (!probers.empty()) return ProbeInParallel(v);
   bool domain_reduced;
   do {
     domain_reduced = false;
@@ -236,14 +682,20 @@ bool Problem<T>::EnforceArcConsistency(size_t v) {
 
       size_t old_domain_size = variable->GetDomainSize();
       Revise(variable, v);
+      // The search stops at the next node.
+      if (*stop) return true;
       size_t new_domain_size = variable->GetDomainSize();
       if (new_domain_size == 0) {
         variable->deadends++;
+        conflict = NULL;
+        wipeout = variable;
         return false;
       }
-      if (new_domain_size == 1) {
-        bool consistent = PropagateDecision(variable);
-        assert(consistent);
+      // The value left was consistent when probed, but learned nogoods may
+      // propagate in another order since their watches have moved.
+      if (new_domain_size == 1 && !PropagateDecision(variable)) {
+        variable->deadends++;
+        return false;
       }
       if (new_domain_size < old_domain_size) {
         variable->ActivateAffectedVariables();
@@ -256,11 +708,226 @@ bool Problem<T>::EnforceArcConsistency(size_t v) {
   return true;
 }
 
+// Make the replicas of parallel SAC and start their threads. False is
+// returned if some constraint cannot be copied. They are made before the
+// search, so they don't have the nogoods that it learns, and may exclude
+// fewer values than serial SAC does.
+template <class T>
+bool Problem<T>::CreateProbers() {
+  Option prober_option = option;
+  prober_option.arc_consistency = false;
+  prober_option.learning = false;
+  prober_option.backjumping = false;
+  prober_option.probe_threads = 1;
+  for (size_t i = 0; i < option.probe_threads; i++) {
+    Problem<T> *prober = Replicate(prober_option);
+    if (!prober) {
+      for (auto *prober : probers) delete prober;
+      probers.clear();
+      return false;
+    }
+    probers.push_back(prober);
+  }
+
+  probe_work.resize(probers.size());
+  for (size_t p = 0; p < probers.size(); p++)
+    prober_threads.emplace_back([this, p] { RunProber(p); });
+  return true;
+}
+
+// Probe the work of the p-th replica at each round until the probers are
+// stopped.
+template <class T>
+void Problem<T>::RunProber(size_t p) {
+  size_t round = 0;
+  for (;;) {
+    {
+      unique_lock<mutex> guard(probe_lock);
+      while (probe_round == round && !probers_stopped) probe_ready.wait(guard);
+      if (probers_stopped) return;
+      round = probe_round;
+    }
+    {
+      // The cost bound of another prober may narrow the domains read here.
+      unique_lock<mutex> guard(solution_lock, defer_lock);
+      if (cost_bound) guard.lock();
+      probers[p]->Synchronize(num_probed_kept, probed_stamps.size());
+    }
+    probers[p]->Probe(probe_work[p], probe_num_decided, variables.size());
+    lock_guard<mutex> guard(probe_lock);
+    if (--busy_probers == 0) probe_done.notify_one();
+  }
+}
+
+// Enforce SAC as EnforceArcConsistency does, in rounds of probes of all the
+// variables that it would revise, which are dealt to the replicas and probed
+// at once. The values that failed are excluded in the order of the variables
+// after each round.
 template <class T>
-void Problem<T>::Solve() {
+bool Problem<T>::ProbeInParallel(size_t v) {
+  // Probes are decisions one level below the search.
+  size_t level = trail.GetLevel();
+  vector<size_t> levels;
+  if (option.backjumping)
+    for (size_t l = 1; l <= level; l++) levels.push_back(l);
+
+  bool domain_reduced;
+  do {
+    domain_reduced = false;
+
+    // Deal the variables in the order of a sweep without reductions.
+    Sort(v);
+    vector<Variable<T> *> round;
+    vector<vector<size_t>> work(probers.size());
+    size_t num_decided = 0;
+    for (size_t i = v; i < variables.size(); i++) {
+      Variable<T> *variable = variables[i];
+      if (variable->GetDomainSize() == 1) {
+        variable->active = false;
+        num_decided++;
+      }
+      if (variable->active == false) continue;
+      variable->active = false;
+      work[round.size() % probers.size()].push_back(variable->GetId());
+      round.push_back(variable);
+      Sort(i + 1);
+    }
+    if (round.empty()) break;
+
+    // The domains only shrink while the checkpoint is open.
+    size_t stamp = trail.GetStamp();
+    if (probed_stamps.empty() || probed_stamps.back() != stamp)
+      probed_stamps.push_back(stamp);
+    {
+      unique_lock<mutex> guard(probe_lock);
+      probe_work.swap(work);
+      probe_num_decided = num_decided;
+      busy_probers = probers.size();
+      probe_round++;
+      probe_ready.notify_all();
+      while (busy_probers > 0) probe_done.wait(guard);
+    }
+    num_probed_kept = probed_stamps.size();
+    for (auto *prober : probers) {
+      for (size_t c = 0; counters[c].name; c++) {
+        counters[c].value += prober->counters[c].value;
+        prober->counters[c].value = 0;
+      }
+    }
+    // The search stops at the next node.
+    if (*stop) return true;
+
+    trail.SetLevel(level);
+    vector<size_t> next_failed(probers.size(), 0);
+    for (size_t k = 0; k < round.size(); k++) {
+      Variable<T> *variable = round[k];
+      Problem<T> *prober = probers[k % probers.size()];
+      size_t id = variable->GetId();
+      size_t old_domain_size = variable->GetDomainSize();
+      for (size_t &f = next_failed[k % probers.size()];
+           f < prober->failed.size() && prober->failed[f].id == id; f++) {
+        const FailedProbe &probe = prober->failed[f];
+        conflict =
+            probe.conflict == SIZE_MAX ? NULL : constraints[probe.conflict];
+        WeighConflict();
+        Exclude(variable, probe.value, levels);
+      }
+      variable->failures = prober->replicas[id].second->failures;
+      if (heap) heap->Update(variable);
+
+      size_t new_domain_size = variable->GetDomainSize();
+      if (new_domain_size == 0) {
+        variable->deadends++;
+        conflict = NULL;
+        wipeout = variable;
+        return false;
+      }
+      if (new_domain_size == 1 && !PropagateDecision(variable)) {
+        variable->deadends++;
+        return false;
+      }
+      if (new_domain_size < old_domain_size) {
+        variable->ActivateAffectedVariables();
+        domain_reduced = true;
+      }
+    }
+  } while (domain_reduced);
+  return true;
+}
+
+// Take the domains of the variables of the master problem. Only the first
+// num_kept of its probed checkpoints were kept open since the last round, so
+// the checkpoints of the others are restored. The domains of the last of its
+// num_checkpoints are subsets of those taken in it before, so only the
+// variables whose domain sizes differ are updated.
+template <class T>
+void Problem<T>::Synchronize(size_t num_kept, size_t num_checkpoints) {
+  for (; num_taken > num_kept; num_taken--) RestoreCheckpoint();
+  if (num_taken < num_checkpoints) {
+    StartCheckpoint();
+    num_taken++;
+  }
+  for (auto &replica : replicas) {
+    Variable<T> *original = replica.first, *copy = replica.second;
+    copy->failures = original->failures;
+    if (copy->GetDomainSize() == original->GetDomainSize()) continue;
+    for (size_t i = copy->GetDomainSize(); i-- > 0;) {
+      T value = copy->GetValue(i);
+      if (!original->GetDomain().Contains(value)) copy->Exclude(value);
+    }
+  }
+}
+
+// Probe the values of variables given by their ids, as Revise does.
+// num_decided of num_variables of the search were decided before the probes.
+template <class T>
+void Problem<T>::Probe(const vector<size_t> &ids, size_t num_decided,
+                       size_t num_variables) {
+  failed.clear();
+  size_t num_synchronized = 0;
+  for (auto *variable : variables)
+    num_synchronized += (variable->GetDomainSize() == 1);
+
+  size_t level = trail.GetLevel();
+  for (size_t id : ids) {
+    Variable<T> *variable = replicas[id].second;
+    size_t domain_size = variable->GetDomainSize();
+    T values[domain_size];
+    master->OrderValues(replicas[id].first, values);
+    for (size_t i = 0; i < domain_size; i++) {
+      if (*stop || IsOverLimit()) return;
+      StartCheckpoint();
+      Decide(variable, values[i], level + 1);
+      bool consistent = PropagateDecision(variable);
+      if (consistent) {
+        size_t num_probed = num_decided;
+        for (auto *other : variables)
+          num_probed += (other->GetDomainSize() == 1);
+        variable->failures +=
+            (num_probed - num_synchronized) / float(num_variables);
+      } else {
+        size_t c = find(constraints.begin(), constraints.end(), conflict) -
+                   constraints.begin();
+        failed.push_back(FailedProbe{id, values[i],
+                                     conflict ? c : SIZE_MAX});
+        variable->failures++;
+      }
+      RestoreCheckpoint();
+      trail.SetLevel(level);
+    }
+  }
+}
+
+template <class T>
+typename Problem<T>::Status Problem<T>::Solve() {
   if (option.optimize && GetSolutionCost() == LONG_MAX) {
     printf("Solution cost function required for optimization mode\n");
-    return;
+    return ERROR;
+  }
+  if (option.optimize) {
+    cost_bound = new CostBound<T>();
+    for (auto *variable : variables) cost_bound->AddVariable(variable);
+    AddConstraint(cost_bound);
   }
 
   for (size_t i = 0; i < constraints.size(); i++) {
@@ -271,40 +938,50 @@ void Problem<T>::Solve() {
   for (size_t i = 0; i < variables.size(); i++) {
     if (variables[i]->GetDomainSize() == 1) {
       bool consistent = variables[i]->PropagateDecision(NULL);
-      if (!consistent) return;
+      if (!consistent) return UNSAT;
+      decided.push_back(variables[i]);
       variables.erase(variables.begin() + i);
       i--;
     }
   }
 
-  if (!EnforceActiveConstraints(true)) return;
-
-  try {
-    if (option.arc_consistency) {
-      bool consistent = EnforceArcConsistency(0);
-      if (!consistent) throw false;
-    }
-
-    storage.clear();
+  if (!EnforceActiveConstraints(true)) return UNSAT;
+  if (!OpenSink()) return ERROR;
 
-    for (size_t i = 0; i < constraints.size(); i++)
-      constraints[i]->UpdateBounds();
-
-    Sort(0);
-    DEBUG(ShowState(NULL));
+  if (option.arc_consistency && option.probe_threads > 1 && !CreateProbers())
+    printf("Parallel SAC requires constraints that can be copied\n");
 
-    while (!Search(0)) {
-      printf("Restart search after %lu backtracks\n", backtrack_count);
-      storage.clear();
-      Sort(0);
-      ShowState(NULL);
-    }
-  } catch (bool result) {
-    ;
+  bool completed = false;
+  if (!option.arc_consistency || EnforceArcConsistency(0)) {
+    if (option.optimize) root_bound = GetCostLowerBound();
+    if (option.counting)
+      completed = CountAll();
+    else if (option.optimize && option.neighborhood_time > 0)
+      completed = SearchNeighborhoods();
+    else if (option.portfolio > 1 && !option.interactive)
+      completed = SolvePortfolio();
+    else if (option.threads > 1 && !option.interactive)
+      completed = SolveInParallel();
+    else
+      completed = Run();
   }
+  completed = completed && !limit_reached;
+  Status status;
+  if (num_solutions == 0)
+    status = completed ? UNSAT : LIMIT;
+  else
+    status = option.optimize && completed ? OPTIMAL : SAT;
+
+  if (sink) sink->Flush();
+  if (option.optimize && min_cost < LONG_MAX)
+    printf("%s cost: %ld\n", completed ? "Optimal" : "Best", min_cost);
   ShowCounters();
 
   if (!option.interactive) {
+    static const char *status_names[] = {"SAT", "UNSAT", "LIMIT", "OPTIMAL",
+                                         "ERROR"};
+    printf("Status: %s\n", status_names[status]);
+    if (limit_reached) printf("Search stopped by a resource limit\n");
     printf("Total time: %.3f s\n", GetTimeUsage());
     printf("Total memory: %ld KB\n", GetMemoryUsage());
     printf("Total backtracks: %lu\n", backtrack_count);
@@ -316,104 +993,962 @@ void Problem<T>::Solve() {
     }
     printf("Total deadends: %d\n", total_deadends);
     printf("Max deadends: %d\n", max_deadends);
+    printf("Total trail entries: %lu\n", trail.GetNumSaved());
+    printf("Skipped trail entries: %lu\n", trail.GetNumSkipped());
+    printf("Max trail size: %lu\n", trail.GetMaxSize());
+    if (option.backjumping || option.decomposition)
+      printf("Total backjumps: %lu\n", backjump_count);
+    if (option.incremental_sac)
+      printf("Cached probes: %lu\n", cached_probe_count);
+    if (option.learning) {
+      printf("Total nogoods: %lu\n", nogood_count);
+      printf("Deleted nogoods: %lu\n", nogoods ? nogoods->GetNumDeleted() : 0);
+    }
   }
+  return status;
 }
 
+// Search for solutions after the initial propagation.
+// Return true if the search space is exhausted or enough solutions are found.
 template <class T>
-bool Problem<T>::Search(size_t v) {
-  search_count++;
+bool Problem<T>::Run() {
+  trail.Clear();
+
+  for (size_t i = 0; i < constraints.size(); i++)
+    constraints[i]->UpdateBounds();
 
-  // Skip variables that have been decided.
-  while (v < variables.size() && variables[v]->GetDomainSize() == 1) {
-    DEBUG(printf("%ld: Variable %ld = %d, 2\n", v, variables[v]->GetId(),
-                 variables[v]->GetValue(0)));
-    v++;
+  Sort(0);
+  DEBUG(ShowState(NULL));
+
+  // Iterations of limited discrepancy search allow one more discrepancy each
+  // time. The last one is unlimited. Values excluded by an iteration may not
+  // be refuted, so the search starts from a checkpoint instead of keeping
+  // them.
+  for (size_t limit = 0;; limit++) {
+    max_discrepancies = limit < option.discrepancies ? limit : SIZE_MAX;
+    pruned = false;
+    if (option.discrepancies) StartCheckpoint();
+
+    while (!Search(0)) {
+      if (*stop) break;
+      if (!master) {
+        printf("Restart search after %lu backtracks\n", backtrack_count);
+        ShowState(NULL);
+      }
+      if (option.discrepancies) RestoreCheckpoint();
+      trail.Clear();
+      if (option.discrepancies) StartCheckpoint();
+      Sort(0);
+    }
+    if (*stop || !pruned) break;
+    if (!master)
+      printf("Search with %lu discrepancies after %lu backtracks\n",
+             limit + 1, backtrack_count);
+    RestoreCheckpoint();
+    trail.Clear();
+    Sort(0);
   }
-  if (v == variables.size()) {
-    ProcessSolution();
-    // Avoid duplicate solutions. Don't restart after one has been found.
-    option.restart = INT_MAX;
-    return true;
+  return !*stop || (!option.optimize && option.num_solutions > 0 &&
+                    num_solutions >= option.num_solutions);
+}
+
+// Large neighborhood search: fix the variables out of a neighborhood to their
+// values in the best solution, and search the others for a better one within
+// a number of backtracks, until the time is up. Neighborhoods are random sets
+// and windows of variable ids in turn. They grow when searched completely and
+// shrink when cut off. True is returned if the whole problem is searched.
+template <class T>
+bool Problem<T>::SearchNeighborhoods() {
+  for (size_t i = 0; i < constraints.size(); i++)
+    constraints[i]->UpdateBounds();
+
+  double end_time = GetTimeUsage() + option.neighborhood_time;
+  double size = 0.2;   // fraction of the variables in a neighborhood
+  size_t limit = 100;  // backtracks of a search
+  size_t num_neighborhoods = 0;
+  bool completed = false;
+  while (!completed && GetTimeUsage() < end_time) {
+    trail.Clear();
+    StartCheckpoint();
+    // All variables are searched until a solution is found.
+    bool is_window = num_neighborhoods++ % 2;
+    size_t num_ids = incumbent.size();
+    size_t first = num_ids ? rand_r(&seed) % num_ids : 0;
+    bool consistent = true;
+    bool relaxed_all = true;
+    for (size_t i = 0; i < variables.size() && num_ids && consistent; i++) {
+      Variable<T> *variable = variables[i];
+      size_t id = variable->GetId();
+      bool relaxed = is_window
+                         ? (id + num_ids - first) % num_ids < size * num_ids
+                         : rand_r(&seed) < size * RAND_MAX;
+      if (relaxed) continue;
+      relaxed_all = false;
+      if (variable->GetDomainSize() == 1) continue;
+      Decide(variable, incumbent[id], 0);
+      consistent = PropagateDecision(variable);
+    }
+
+    // A neighborhood that fails in propagation is searched completely.
+    bool cut_off = false;
+    if (consistent) {
+      Sort(0);
+      option.restart = backtrack_count + limit;
+      cut_off = !Search(0);
+    }
+    if (!cut_off) {
+      completed = relaxed_all;
+      size = min(size * 1.1, 1.0);
+    } else if (num_ids) {
+      size /= 1.1;
+    } else {
+      limit *= 2;
+    }
+    RestoreCheckpoint();
+    if (*stop) break;
   }
+  option.restart = INT_MAX;
+  printf("Searched %lu neighborhoods\n", num_neighborhoods);
+  return completed && !*stop;
+}
 
-  Variable<T> *variable = variables[v];
-  DEBUG(variable->ShowDomain());
+// Count the solutions without enumerating them. Components of the problem,
+// i.e. variables connected by constraints with undecided variables, are
+// counted independently, and their counts are cached. Each decision is
+// followed by SAC if it is enabled, so values that fail are pruned before
+// their subtrees are split. The time still grows exponentially with the size
+// of components that decisions don't split: random 3-SAT of about 200
+// variables (Sat/sat.in9, unsat.in9) is counted in under a minute, and
+// larger models need a time limit.
+template <class T>
+bool Problem<T>::CountAll() {
+  trail.Clear();
+  for (size_t i = 0; i < constraints.size(); i++)
+    constraints[i]->UpdateBounds();
 
-  size_t domain_size = variable->GetDomainSize();
-  T values[domain_size];
-  OrderValues(variable, values);
-  bool is_deadend = true;
-  if (option.learning) nogood.emplace_back(variable, &values[0], domain_size);
-  for (size_t i = 0; i < domain_size; ++i) {
-    if (i < domain_size - 1) StartCheckpoint();
-    variable->Decide(values[i]);
-    if (option.learning) nogood.back().index = i;
+  size_t count = CountComponents(variables, 1);
+  if (*stop) return false;
+  num_solutions = count;
+  if (count_overflow)
+    printf("Total solutions: more than %lu\n", count);
+  else
+    printf("Total solutions: %lu\n", count);
+  printf("Cached components: %lu\n", component_counts.size());
+  printf("Cache hits: %lu\n", cache_hits);
+  return true;
+}
+
+// Multiply the counts of the components of the undecided variables in scope.
+template <class T>
+size_t Problem<T>::CountComponents(const vector<Variable<T> *> &scope,
+                                   size_t level) {
+  vector<vector<Variable<T> *>> components;
+  GetComponents(scope, &components);
+  if (components.empty()) {
+    // IsValidSolution can only check problems that aren't decomposed, whose
+    // variables are all decided together.
+    if (!IsDecomposable()) return IsValidSolution();
+    assert(IsValidSolution());
+    return 1;
+  }
+
+  size_t count = 1;
+  for (size_t i = 0; i < components.size() && count > 0; i++) {
+    size_t component_count = CountComponent(components[i], level);
+    if (__builtin_mul_overflow(count, component_count, &count)) {
+      count = SIZE_MAX;
+      count_overflow = true;
+    }
+  }
+  return count;
+}
+
+// Count the solutions of a component by trying each value of the variable
+// with the smallest domain.
+template <class T>
+size_t Problem<T>::CountComponent(const vector<Variable<T> *> &component,
+                                  size_t level) {
+  if (*stop || IsOverLimit()) return 0;
+  search_count++;
+
+  string key;
+  if (IsDecomposable()) {
+    GetComponentKey(component, &key);
+    auto found = component_counts.find(key);
+    if (found != component_counts.end()) {
+      cache_hits++;
+      return found->second;
+    }
+  }
+
+  // Ties are broken by the number of constraints that still connect the
+  // variable, whose decision is the most likely to split the component.
+  Variable<T> *variable = NULL;
+  size_t min_domain_size = SIZE_MAX, max_degree = 0;
+  for (auto *other : component) {
+    size_t domain_size = other->GetDomainSize();
+    if (domain_size > min_domain_size) continue;
+    size_t degree = 0;
+    for (auto *constraint : other->GetConstraints())
+      if (constraint->IsOpen() && !constraint->IsEntailed()) degree++;
+    if (domain_size < min_domain_size || degree > max_degree) {
+      variable = other;
+      min_domain_size = domain_size;
+      max_degree = degree;
+    }
+  }
+  vector<T> values;
+  for (size_t i = 0; i < variable->GetDomainSize(); i++)
+    values.push_back(variable->GetValue(i));
+
+  size_t count = 0;
+  for (T value : values) {
+    StartCheckpoint();
+    Decide(variable, value, level);
     bool consistent = PropagateDecision(variable);
     if (consistent && option.arc_consistency) {
       variable->ActivateAffectedVariables();
-      consistent = EnforceArcConsistency(v + 1);
+      consistent = EnforceArcConsistency(0);
     }
-    DEBUG(printf("%ld: Variable %ld = %d, %d\n", v, variable->GetId(),
-                 values[i], consistent));
     if (consistent) {
-      is_deadend = false;
-      Sort(v + 1);
-      DEBUG(ShowState(variable));
-      if (!Search(v + 1)) {
-        if (i < domain_size - 1) RestoreCheckpoint();
-        return false;
+      size_t component_count = CountComponents(component, level + 1);
+      if (__builtin_add_overflow(count, component_count, &count)) {
+        count = SIZE_MAX;
+        count_overflow = true;
+      }
+    } else {
+      backtrack_count++;
+    }
+    RestoreCheckpoint();
+  }
+
+  // The cache is bounded by starting over when it is full.
+  if (*stop || key.empty()) return count;
+  if (component_counts.size() >= (1 << 20)) component_counts.clear();
+  component_counts[key] = count;
+  return count;
+}
+
+// Split the undecided variables in scope into sets connected by constraints.
+// Without decomposition, they are all in one set.
+template <class T>
+void Problem<T>::GetComponents(const vector<Variable<T> *> &scope,
+                               vector<vector<Variable<T> *>> *components) {
+  mark++;
+  for (auto *root : scope) {
+    size_t id = root->GetId();
+    if (id >= marks.size()) marks.resize(id + 1, 0);
+    if (root->GetDomainSize() == 1 || marks[id] == mark) continue;
+    if (!IsDecomposable() && !components->empty()) {
+      components->back().push_back(root);
+      continue;
+    }
+    marks[id] = mark;
+    components->emplace_back(1, root);
+    if (!IsDecomposable()) continue;
+
+    // Visit variables breadth first.
+    vector<Variable<T> *> &component = components->back();
+    for (size_t i = 0; i < component.size(); i++) {
+      for (auto *constraint : component[i]->GetConstraints()) {
+        if (constraint->IsEntailed() || constraint->mark == mark) continue;
+        constraint->mark = mark;
+        for (auto *variable : constraint->GetVariables()) {
+          size_t id = variable->GetId();
+          if (id >= marks.size()) marks.resize(id + 1, 0);
+          if (variable->GetDomainSize() == 1 || marks[id] == mark) continue;
+          marks[id] = mark;
+          component.push_back(variable);
+        }
+      }
+    }
+  }
+}
+
+// The domains of the variables of a component, and of the decided variables
+// that share constraints with them which are not entailed, as bytes in the
+// order of variable ids.
+template <class T>
+void Problem<T>::GetComponentKey(const vector<Variable<T> *> &component,
+                                 string *key) {
+  vector<Variable<T> *> scope = component;
+  mark++;
+  for (auto *variable : component) marks[variable->GetId()] = mark;
+  for (auto *variable : component) {
+    for (auto *constraint : variable->GetConstraints()) {
+      if (constraint->IsEntailed() || constraint->mark == mark) continue;
+      constraint->mark = mark;
+      for (auto *other : constraint->GetVariables()) {
+        size_t id = other->GetId();
+        if (id >= marks.size()) marks.resize(id + 1, 0);
+        if (marks[id] == mark) continue;
+        marks[id] = mark;
+        scope.push_back(other);
       }
     }
-    if (i < domain_size - 1) RestoreCheckpoint();
-    variable->Exclude(values[i]);
   }
-  if (is_deadend) {
-    DEBUG(printf("%ld: Variable %ld failures %f\n", v, variable->GetId(),
-                 variable->failures));
-    variable->failures++;
-    // ShowState(variable);
+  sort(scope.begin(), scope.end(),
+       [](const Variable<T> *v1, const Variable<T> *v2) {
+         return v1->GetId() < v2->GetId();
+       });
+
+  vector<T> values;
+  for (auto *variable : scope) {
+    size_t id = variable->GetId();
+    size_t size = variable->GetDomainSize();
+    values.clear();
+    for (size_t i = 0; i < size; i++) values.push_back(variable->GetValue(i));
+    sort(values.begin(), values.end());
+    key->append((const char *)&id, sizeof(id));
+    key->append((const char *)&size, sizeof(size));
+    for (T value : values) key->append((const char *)&value, sizeof(value));
+  }
+}
+
+// Make a copy of the variables and constraints, which can be searched on
+// another thread. NULL is returned if some constraint cannot be copied.
+// Every variable is copied with its id, including those decided before the
+// search and those without constraints, so replicas[id] is the copy of the
+// variable of that id in both problems.
+template <class T>
+Problem<T> *Problem<T>::Replicate(Option option) {
+  Problem<T> *replica = new Problem<T>(option);
+  replica->master = this;
+  replica->stop = stop;
+  replica->start_time = start_time;
+
+  map<Variable<T> *, Variable<T> *> copies;
+  replica->replicas.resize(variables.size() + decided.size());
+  for (auto *list : {&variables, &decided}) {
+    for (auto *variable : *list) {
+      Variable<T> *copy = new Variable<T>(*variable);
+      copy->active = true;
+      copy->SetTrail(&replica->trail);
+      copies[variable] = copy;
+      replica->replicas[variable->GetId()] = make_pair(variable, copy);
+    }
+  }
+  for (auto &replica_pair : replica->replicas)
+    replica->variables.push_back(replica_pair.second);
+
+  for (auto *constraint : constraints) {
+    Constraint<T> *copy = constraint->Clone();
+    if (!copy) {
+      delete replica;
+      return NULL;
+    }
+    copy->ReplaceVariables(copies);
+    replica->AddConstraint(copy);
+    if (constraint == cost_bound)
+      replica->cost_bound = static_cast<CostBound<T> *>(copy);
+  }
+  return replica;
+}
+
+// Race replicas with different options on separate threads. The first one
+// that finishes the search stops the others and its solutions are reported.
+// In optimization mode, members share the bound of the best cost, so the best
+// solution may have been found by another member and all are reported.
+template <class T>
+bool Problem<T>::SolvePortfolio() {
+  vector<Problem<T> *> members;
+  for (size_t i = 0; i < option.portfolio; i++) {
+    Problem<T> *member = Replicate(option.GetPortfolioMember(i));
+    if (!member) {
+      printf("Portfolio requires constraints that can be copied\n");
+      for (auto *member : members) delete member;
+      return Run();
+    }
+    members.push_back(member);
+  }
+
+  // Node and backtrack limits apply to each member.
+  Problem<T> *winner = NULL;
+  vector<thread> threads;
+  for (auto *member : members) {
+    threads.emplace_back([this, member, &winner] {
+      bool completed = member->Run();
+      lock_guard<mutex> guard(solution_lock);
+      if (completed && !winner) {
+        winner = member;
+        *stop = true;
+      }
+    });
+  }
+  for (auto &thread : threads) thread.join();
+
+  // All members have been stopped by a limit if none finished.
+  bool completed = winner != NULL;
+  if (completed) {
+    size_t index =
+        find(members.begin(), members.end(), winner) - members.begin();
+    printf("Portfolio member %lu finished first\n", index);
+  } else {
+    winner = members[0];
+  }
+  *stop = false;
+  for (auto *member : members) {
+    if (member != winner && !option.optimize) continue;
+    for (const auto &solution : member->solutions) {
+      search_count = solution.search_count;
+      backtrack_count = solution.backtrack_count;
+      StartCheckpoint();
+      LoadSolution(member, solution.values);
+      ProcessSolution();
+      RestoreCheckpoint();
+    }
+  }
+  search_count = winner->search_count;
+  backtrack_count = winner->backtrack_count;
+  backjump_count = winner->backjump_count;
+  nogood_count = winner->nogood_count;
+  for (size_t i = 0; counters[i].name; i++)
+    counters[i].value = winner->counters[i].value;
+  for (auto &replica : winner->replicas)
+    replica.first->deadends = replica.second->deadends;
+  trail.AddStatistics(winner->trail);
+
+  for (auto *member : members) delete member;
+  return completed;
+}
+
+// Search subtrees of the model with replicas on separate threads. A replica
+// shares untried values near the root as jobs when other replicas are idle.
+template <class T>
+bool Problem<T>::SolveInParallel() {
+  Option worker_option = option;
+  worker_option.learning = false;
+  worker_option.progress = 0;
+  worker_option.restart = INT_MAX;
+  worker_option.discrepancies = 0;
+  // Jobs are searched without the decisions of other replicas, so conflicts
+  // can't be traced back through them.
+  worker_option.backjumping = false;
+
+  vector<Problem<T> *> workers;
+  for (size_t i = 0; i < option.threads; i++) {
+    Problem<T> *worker = Replicate(worker_option);
+    if (!worker) {
+      printf("Parallel search requires constraints that can be copied\n");
+      for (auto *worker : workers) delete worker;
+      return Run();
+    }
+    workers.push_back(worker);
+  }
+
+  trail.Clear();
+  jobs.push_back(Job());
+  vector<thread> threads;
+  for (auto *worker : workers)
+    threads.emplace_back([worker] { worker->Work(); });
+  for (auto &thread : threads) thread.join();
+
+  for (auto *worker : workers) {
+    for (size_t i = 0; counters[i].name; i++)
+      counters[i].value += worker->counters[i].value;
+    for (auto &replica : worker->replicas)
+      replica.first->deadends += replica.second->deadends;
+    trail.AddStatistics(worker->trail);
+    delete worker;
+  }
+  return true;
+}
+
+// Search jobs until all replicas are idle or the search is stopped.
+template <class T>
+void Problem<T>::Work() {
+  trail.Clear();
+  while (master->TakeJob(&job)) {
+    StartCheckpoint();
+    if (Replay(job)) {
+      Sort(0);
+      Search(0);
+    }
+    RestoreCheckpoint();
+    master->FinishJob(this);
   }
-  if (++backtrack_count >= option.restart) {
-    if (option.learning) LearnNewNogoods();
-    option.restart = option.restart * 1.618;
+}
+
+// Wait for a job. False is returned when there is no more work to do.
+template <class T>
+bool Problem<T>::TakeJob(Job *job) {
+  unique_lock<mutex> guard(job_lock);
+  idle_workers++;
+  while (jobs.empty() && idle_workers < option.threads && !*stop)
+    job_ready.wait(guard);
+  if (jobs.empty() || *stop) {
+    job_ready.notify_all();
     return false;
   }
-  if (option.learning) nogood.pop_back();
-  if (option.progress && backtrack_count % option.progress == 0) {
-    printf("----- %lu -----\n", backtrack_count);
-    ShowState(NULL);
+  idle_workers--;
+  *job = jobs.front();
+  jobs.pop_front();
+  return true;
+}
+
+// Collect statistics of a replica after it finishes a job.
+template <class T>
+void Problem<T>::FinishJob(Problem<T> *replica) {
+  lock_guard<mutex> guard(solution_lock);
+  search_count += replica->search_count;
+  backtrack_count += replica->backtrack_count;
+  replica->search_count = replica->backtrack_count = 0;
+  // Replicas check limits on their counts of the current job.
+  IsOverLimit();
+}
+
+// Give the untried values of the shallowest decision to idle replicas.
+template <class T>
+void Problem<T>::ShareJobs() {
+  lock_guard<mutex> guard(master->job_lock);
+  if (!master->jobs.empty()) return;
+
+  Job prefix = job;
+  for (size_t d = 0; d < depth; d++) {
+    Frame &frame = path[d];
+    size_t id = frame.variable->GetId();
+    if (frame.index < frame.size - 1) {
+      for (int i = frame.index + 1; i < frame.size; i++) {
+        master->jobs.push_back(prefix);
+        master->jobs.back().push_back(make_pair(id, frame.values[i]));
+      }
+      frame.size = frame.index + 1;
+      master->job_ready.notify_all();
+      return;
+    }
+    prefix.push_back(make_pair(id, frame.values[frame.index]));
+  }
+}
+
+// Make the decisions of a job. False is returned if they are inconsistent.
+// Jobs name variables by id, which every replica keeps, so a job shared by
+// one replica is replayed on the same variables by the others. Sorting
+// reorders the variables, but not replicas.
+template <class T>
+bool Problem<T>::Replay(const Job &job) {
+  for (const auto &decision : job) {
+    Variable<T> *variable = replicas[decision.first].second;
+    if (variable->Is(decision.second)) continue;
+    if (!variable->Maybe(decision.second)) return false;
+    variable->Decide(decision.second);
+    if (!PropagateDecision(variable)) return false;
+    if (option.arc_consistency) {
+      variable->ActivateAffectedVariables();
+      if (!EnforceArcConsistency(0)) return false;
+    }
   }
   return true;
 }
 
+// Report a solution found by a replica in parallel search.
+template <class T>
+void Problem<T>::AcceptSolution(Problem<T> *replica) {
+  lock_guard<mutex> guard(solution_lock);
+  if (*stop) return;
+  search_count += replica->search_count;
+  backtrack_count += replica->backtrack_count;
+  StartCheckpoint();
+  for (auto &copy : replica->replicas)
+    copy.first->Decide(copy.second->GetValue(0));
+  ProcessSolution();
+  RestoreCheckpoint();
+  search_count -= replica->search_count;
+  backtrack_count -= replica->backtrack_count;
+}
+
+// Check a solution found by a replica with the master's validity and cost.
+template <class T>
+bool Problem<T>::EvaluateSolution(Problem<T> *replica, long *cost) {
+  vector<T> values;
+  for (auto &copy : replica->replicas)
+    values.push_back(copy.second->GetValue(0));
+
+  lock_guard<mutex> guard(solution_lock);
+  StartCheckpoint();
+  LoadSolution(replica, values);
+  bool valid = IsValidSolution();
+  if (valid && option.optimize) *cost = GetSolutionCost();
+  RestoreCheckpoint();
+  return valid;
+}
+
+template <class T>
+long Problem<T>::GetLowerBound() {
+  return master ? master->GetReplicaLowerBound(this) : GetCostLowerBound();
+}
+
+// Bound the costs in the domains of a replica with the master's model, whose
+// variables are narrowed to the domains of their copies.
+template <class T>
+long Problem<T>::GetReplicaLowerBound(Problem<T> *replica) {
+  lock_guard<mutex> guard(solution_lock);
+  StartCheckpoint();
+  for (auto &copy : replica->replicas) {
+    Variable<T> *original = copy.first;
+    if (original->GetDomainSize() == copy.second->GetDomainSize()) continue;
+    for (size_t i = original->GetDomainSize(); i-- > 0;)
+      if (!copy.second->GetDomain().Contains(original->GetValue(i)))
+        original->ExcludeAt(i);
+  }
+  long bound = GetCostLowerBound();
+  RestoreCheckpoint();
+  return bound;
+}
+
+// Assign values of a replica's solution to the original variables.
+template <class T>
+void Problem<T>::LoadSolution(Problem<T> *replica, const vector<T> &values) {
+  for (size_t i = 0; i < values.size(); i++)
+    replica->replicas[i].first->Decide(values[i]);
+}
+
+// Depth-first search from the v-th variable with an explicit stack of frames.
+// False is returned if the search is stopped or restarted.
 template <class T>
-void Problem<T>::LearnNewNogoods() {
-  vector<pair<Variable<T> *, T>> assignments;
-  for (const auto &backtrack : nogood) {
-    for (int i = 0; i <= backtrack.index; ++i) {
-      assignments.push_back(make_pair(backtrack.variable, backtrack.values[i]));
-      if (i < backtrack.index) {
-        if (assignments.size() == 1)
-          backtrack.variable->Exclude(backtrack.values[i]);
-        else
-          AddConstraint(new Nogood<T>(assignments));
+bool Problem<T>::Search(size_t v) {
+  size_t base = depth;
+  bool descend = true;  // enter the node at v or return to the top frame
+  bool result = true;   // result of the node returning to the top frame
+  for (;;) {
+    if (descend) {
+      descend = false;
+      if (*stop || IsOverLimit()) {
+        result = false;
+      } else {
+        search_count++;
+        if (master && master->idle_workers > 0 && option.threads > 1)
+          ShareJobs();
+
+        // Skip variables that have been decided.
+        while (v < variables.size() && variables[v]->GetDomainSize() == 1) {
+          DEBUG(printf("%ld: Variable %ld = %d, 2\n", v, variables[v]->GetId(),
+                       variables[v]->GetValue(0)));
+          v++;
+        }
+        if (v == variables.size()) {
+          if (IsNewSolution()) ProcessSolution();
+          // Avoid duplicate solutions. Don't restart after one has been found.
+          // Neighborhoods are cut off by restarts instead.
+          if (option.neighborhood_time == 0) option.restart = INT_MAX;
+          // Other solutions may depend on any decision.
+          jump_levels.clear();
+          for (size_t l = 1; l <= depth; l++) jump_levels.push_back(l);
+          result = true;
+        } else {
+          PushFrame(v);
+          result = true;
+          descend = true;
+        }
+      }
+    }
 
-        printf("Nogood ");
-        for (const auto &assignment : assignments) {
-          printf("%lu=%d ", assignment.first->GetId(), assignment.second);
+    if (!descend) {
+      // A node returns its result to the top frame.
+      if (depth == base) return result;
+      Frame &frame = path[depth - 1];
+      if (!result || *stop) {
+        if (frame.checkpoint) RestoreCheckpoint();
+        depth--;
+        result = false;
+        continue;
+      }
+      if (option.backjumping || option.decomposition) {
+        // Jump back over decisions that the subtree doesn't depend on.
+        if (jump_levels.empty() || jump_levels.back() < depth) {
+          if (frame.checkpoint) RestoreCheckpoint();
+          depth--;
+          backjump_count++;
+          continue;
         }
-        putchar('\n');
+        jump_levels.pop_back();
+        MergeLevels(&frame.conflict, jump_levels);
+      }
+      if (frame.checkpoint) RestoreCheckpoint();
+      trail.SetLevel(depth);
+      Exclude(frame.variable, frame.values[frame.index], jump_levels);
+    }
+    descend = false;
+
+    // Try the next value of the top frame.
+    Frame &frame = path[depth - 1];
+    Variable<T> *variable = frame.variable;
+    vector<size_t> levels;
+    // Remaining values may have been shared with other replicas.
+    while (frame.index + 1 < frame.size) {
+      if (frame.index >= 0 && frame.discrepancies >= max_discrepancies) {
+        // The untried values may lead to solutions that any decision affects.
+        pruned = true;
+        frame.is_deadend = false;
+        frame.conflict.clear();
+        for (size_t l = 1; l <= depth; l++) frame.conflict.push_back(l);
+        break;
+      }
+      frame.index++;
+      T value = frame.values[frame.index];
+      frame.checkpoint = frame.index < frame.size - 1;
+      if (frame.checkpoint) StartCheckpoint();
+      Decide(variable, value, depth);
+      bool consistent = PropagateDecision(variable);
+      if (consistent && option.arc_consistency) {
+        variable->ActivateAffectedVariables();
+        consistent = EnforceArcConsistency(frame.v + 1);
+      }
+      DEBUG(printf("%ld: Variable %ld = %d, %d\n", frame.v, variable->GetId(),
+                   value, consistent));
+      if (consistent) {
+        if (option.phase_saving) SavePhase(variable, value);
+        frame.is_deadend = false;
+        Sort(frame.v + 1);
+        DEBUG(ShowState(variable));
+        v = frame.v + 1;
+        descend = true;
+        break;
+      }
+      if (option.learning) LearnNogood();
+      GetConflictLevels(depth, &levels);
+      MergeLevels(&frame.conflict, levels);
+      if (frame.checkpoint) RestoreCheckpoint();
+      trail.SetLevel(depth);
+      Exclude(variable, value, levels);
+    }
+    if (descend) continue;
+
+    // All values of the top frame have been tried.
+    jump_levels = frame.conflict;
+    if (option.decomposition && !option.backjumping) {
+      GetComponentLevels(depth, &levels);
+      MergeLevels(&jump_levels, levels);
+    }
+    if (frame.is_deadend) {
+      DEBUG(printf("%ld: Variable %ld failures %f\n", frame.v,
+                   variable->GetId(), variable->failures));
+      variable->failures++;
+      if (heap) heap->Update(variable);
+    }
+    if (++backtrack_count >= option.restart) {
+      if (option.phase_saving) {
+        for (auto *decided : variables)
+          if (decided->GetDomainSize() == 1)
+            SavePhase(decided, decided->GetValue(0));
       }
-      if (i < backtrack.index || backtrack.index == backtrack.size - 1)
-        assignments.pop_back();
+      ScheduleRestart();
+      depth--;
+      result = false;
+      continue;
+    }
+    depth--;
+    if (option.progress && backtrack_count % option.progress == 0) {
+      printf("----- %lu -----\n", backtrack_count);
+      ShowState(NULL);
+      if (option.optimize && min_cost < LONG_MAX) ShowGap();
     }
-    if (assignments.size() == 10) break;
+    result = true;
+  }
+}
+
+// Push a frame to try values of the v-th variable.
+template <class T>
+void Problem<T>::PushFrame(size_t v) {
+  if (depth == path.size()) path.emplace_back();
+  Frame &frame = path[depth];
+  frame.discrepancies = GetDiscrepancies();
+  depth++;
+  frame.variable = variables[v];
+  DEBUG(frame.variable->ShowDomain());
+
+  size_t domain_size = frame.variable->GetDomainSize();
+  if (frame.capacity < domain_size) {
+    frame.values.reset(new T[domain_size]);
+    frame.capacity = domain_size;
+  }
+  OrderValues(frame.variable, frame.values.get());
+  frame.size = domain_size;
+  frame.index = -1;
+  frame.v = v;
+  frame.checkpoint = false;
+  frame.is_deadend = true;
+  frame.conflict.clear();
+
+  // Label the components of the undecided variables. Conflict directed
+  // backjumping finds the levels that failures depend on more precisely.
+  if (option.decomposition && !option.backjumping) {
+    vector<vector<Variable<T> *>> components;
+    GetComponents(variables, &components);
+    frame.components.assign(marks.size(), SIZE_MAX);
+    for (size_t c = 0; c < components.size(); c++)
+      for (auto *variable : components[c])
+        frame.components[variable->GetId()] = c;
   }
-  nogood.clear();
+}
+
+// Find the levels above a frame whose decisions were made in the component of
+// its variable. The values of other components are independent of it, so its
+// failure doesn't depend on them.
+template <class T>
+void Problem<T>::GetComponentLevels(size_t level,
+                                    vector<size_t> *levels) const {
+  levels->clear();
+  size_t id = path[level - 1].variable->GetId();
+  for (size_t l = 1; l < level; l++) {
+    const Frame &frame = path[l - 1];
+    if (frame.components[id] == frame.components[frame.variable->GetId()])
+      levels->push_back(l);
+  }
+}
+
+// Set option.restart to the number of backtracks of the next restart.
+template <class T>
+void Problem<T>::ScheduleRestart() {
+  num_restarts++;
+  switch (option.restart_strategy) {
+    case Option::RESTART_GEOMETRIC:
+      option.restart = option.restart * 1.618;
+      break;
+    case Option::RESTART_LUBY:
+      option.restart = backtrack_count + restart_unit * Luby(num_restarts + 1);
+      break;
+    case Option::RESTART_INNER_OUTER:
+      // The inner limit grows up to the outer one, which then grows.
+      if (inner_restart >= outer_restart) {
+        outer_restart *= 1.1;
+        inner_restart = restart_unit;
+      } else {
+        inner_restart *= 1.1;
+      }
+      option.restart = backtrack_count + (size_t)inner_restart;
+      break;
+  }
+}
+
+// The i-th term of the Luby sequence 1, 1, 2, 1, 1, 2, 4, 1, ... from 1.
+template <class T>
+size_t Problem<T>::Luby(size_t i) {
+  for (;;) {
+    size_t k = 1;
+    while (((size_t)1 << k) - 1 < i) k++;
+    if (i == ((size_t)1 << k) - 1) return (size_t)1 << (k - 1);
+    i -= ((size_t)1 << (k - 1)) - 1;
+  }
+}
+
+template <class T>
+void Problem<T>::SavePhase(Variable<T> *variable, T value) {
+  size_t id = variable->GetId();
+  if (id >= phases.size()) {
+    phases.resize(id + 1);
+    phased.resize(id + 1, false);
+  }
+  phases[id] = value;
+  phased[id] = true;
+}
+
+// Stop the search or the probes if a resource limit has been reached. Clocks
+// are slower to read than the counts, so the number of checks between their
+// readings is adapted for them to be read about every millisecond.
+template <class T>
+bool Problem<T>::IsOverLimit() {
+  bool over =
+      (option.node_limit && search_count >= option.node_limit) ||
+      (option.backtrack_limit && backtrack_count >= option.backtrack_limit) ||
+      (option.memory_limit && trail.GetMemoryUsage() >= option.memory_limit);
+  if (!over && (option.cpu_limit > 0 || option.time_limit > 0) &&
+      ++limit_checks >= clock_stride) {
+    limit_checks = 0;
+    double wall_time = GetWallTime();
+    if (wall_time - clock_time < 0.0005)
+      clock_stride *= 2;
+    else if (wall_time - clock_time > 0.002 && clock_stride > 1)
+      clock_stride /= 2;
+    clock_time = wall_time;
+    over = (option.cpu_limit > 0 && GetTimeUsage() >= option.cpu_limit) ||
+           (option.time_limit > 0 && wall_time >= option.time_limit);
+  }
+  if (!over) return false;
+  (master ? master : this)->limit_reached = true;
+  *stop = true;
+  return true;
+}
+
+// Number of discrepancies of the current search path.
+template <class T>
+size_t Problem<T>::GetDiscrepancies() const {
+  if (depth == 0) return 0;
+  const Frame &top = path[depth - 1];
+  return top.discrepancies + (top.index > 0);
+}
+
+// Whether a solution has not been reported by an earlier iteration of limited
+// discrepancy search.
+template <class T>
+bool Problem<T>::IsNewSolution() {
+  if (!option.discrepancies) return true;
+  vector<T> values;
+  GetValues(&values);
+  if (max_discrepancies == SIZE_MAX) return !limited_solutions.count(values);
+  return limited_solutions.insert(values).second;
+}
+
+// Values of the decided variables by id. Variables decided before the search
+// have been removed.
+template <class T>
+void Problem<T>::GetValues(vector<T> *values) const {
+  for (auto *variable : variables) {
+    size_t id = variable->GetId();
+    if (id >= values->size()) values->resize(id + 1);
+    (*values)[id] = variable->GetValue(0);
+  }
+}
+
+// Bound the cost of later solutions by the best one found, so that nodes
+// whose lower bound reaches it fail in propagation.
+template <class T>
+void Problem<T>::BoundCost() {
+  cost_bound->SetBound(min_cost);
+  ActivateConstraint(cost_bound);
+}
+
+template <class T>
+void Problem<T>::ShowGap() const {
+  if (root_bound == LONG_MIN)
+    printf("Cost %ld\n", min_cost);
+  else
+    printf("Cost %ld, lower bound %ld, gap %ld\n", min_cost, root_bound,
+           min_cost - root_bound);
+}
+
+// Learn a nogood from the last failure before it is backtracked. It is
+// enforced when the search propagates next.
+template <class T>
+void Problem<T>::LearnNogood() {
+  vector<Literal<T>> literals;
+  size_t lbd;
+  if (!trail.Analyze(conflict, wipeout, &literals, &lbd)) return;
+  if (!nogoods) {
+    nogoods = new NogoodStore<T>();
+    AddConstraint(nogoods);
+  }
+  nogoods->Add(literals, lbd);
+  ActivateConstraint(nogoods);
+  nogood_count++;
 }
 
 template <class T>
 void Problem<T>::Sort(size_t v) {
+  // Weighted degrees change with decisions on neighbors, so they are always
+  // scanned.
+  if (option.heap && option.sort != Option::SORT_DISABLED &&
+      option.sort != Option::SORT_WEIGHTED_DEGREE) {
+    if (!heap) {
+      typename VariableHeap<T>::Compare before =
+          option.sort == Option::SORT_DOMAIN_SIZE ? HasSmallerDomain
+          : option.sort == Option::SORT_FAILURES  ? HasMoreFailures
+                                                  : HasSmallerWeight;
+      heap = new VariableHeap<T>(variables, before);
+    }
+    heap->Select(v);
+    return;
+  }
+
   switch (option.sort) {
     case Option::SORT_DISABLED:
       break;
@@ -476,26 +2011,63 @@ void Problem<T>::Sort(size_t v) {
         swap(variables[v], variables[min_index]);
       break;
     }
+    case Option::SORT_WEIGHTED_DEGREE: {
+      float min_ratio = INT_MAX;
+      size_t min_index = variables.size();
+      for (size_t i = v; i < variables.size(); i++) {
+        size_t domain_size = variables[i]->GetDomainSize();
+        if (domain_size == 1) {
+          swap(variables[v], variables[i]);
+          if (min_index == v) min_index = i;
+          v++;
+        } else {
+          float ratio = domain_size / variables[i]->GetWeightedDegree();
+          if (min_ratio > ratio) {
+            min_ratio = ratio;
+            min_index = i;
+          }
+        }
+      }
+      if (min_index != variables.size())
+        swap(variables[v], variables[min_index]);
+      break;
+    }
   }
 }
 
+// Orders of variables for the heap, which agree with the linear scan of Sort.
+template <class T>
+bool Problem<T>::HasSmallerDomain(const Variable<T> *v1,
+                                  const Variable<T> *v2) {
+  size_t size1 = v1->GetDomainSize(), size2 = v2->GetDomainSize();
+  return size1 < size2 || (size1 == size2 && v1->failures > v2->failures);
+}
+
+template <class T>
+bool Problem<T>::HasMoreFailures(const Variable<T> *v1, const Variable<T> *v2) {
+  return v1->failures > v2->failures;
+}
+
+template <class T>
+bool Problem<T>::HasSmallerWeight(const Variable<T> *v1,
+                                  const Variable<T> *v2) {
+  return (v1->GetDomainSize() - 2) / (v1->failures + 1) <
+         (v2->GetDomainSize() - 2) / (v2->failures + 1);
+}
+
 template <class T>
 void Problem<T>::StartCheckpoint() {
-  storage.push_back(make_pair((Variable<T> *)NULL, 0));
+  trail.StartCheckpoint();
 }
 
 template <class T>
 void Problem<T>::RestoreCheckpoint() {
-  for (;;) {
-    pair<Variable<T> *, size_t> &state = storage.back();
-    if (state.first) {
-      state.first->Restore(state.second);
-      storage.pop_back();
-    } else {
-      storage.pop_back();
-      break;
-    }
+  // Parallel SAC took domains in the checkpoint.
+  if (!probed_stamps.empty() && probed_stamps.back() == trail.GetStamp()) {
+    probed_stamps.pop_back();
+    num_probed_kept = min(num_probed_kept, probed_stamps.size());
   }
+  trail.RestoreCheckpoint();
 }
 
 template <class T>
@@ -531,29 +2103,119 @@ bool Problem<T>::CheckSolution(size_t v) {
 
 template <class T>
 void Problem<T>::ProcessSolution() {
-  if (!IsValidSolution()) return;
+  if (master && option.threads > 1) {
+    master->AcceptSolution(this);
+    return;
+  }
+  long cost = LONG_MAX;
+  bool valid = master ? master->EvaluateSolution(this, &cost)
+                      : IsValidSolution();
+  if (!valid) return;
   num_solutions++;
   if (option.optimize) {
-    long cost = GetSolutionCost();
+    if (!master) cost = GetSolutionCost();
     if (min_cost > cost) {
       min_cost = cost;
-      printf(
-          "----- Solution %ld after %ld searches, %ld backtracks and %.3fs "
-          "-----\n",
-          num_solutions, search_count, backtrack_count, GetTimeUsage());
-      ShowSolution();
+      ReportSolution();
+      BoundCost();
+      if (option.neighborhood_time > 0) GetValues(&incumbent);
     }
   } else {
-    printf(
-        "----- Solution %ld after %ld searches, %ld backtracks and %.3fs -----\n",
-        num_solutions, search_count, backtrack_count, GetTimeUsage());
-    ShowSolution();
+    ReportSolution();
     if (option.num_solutions > 0 && num_solutions >= option.num_solutions) {
-      throw true;
+      *stop = true;
     }
   }
 }
 
+template <class T>
+void Problem<T>::ReportSolution() {
+  if (master) {
+    Solution solution;
+    for (auto &copy : replicas)
+      solution.values.push_back(copy.second->GetValue(0));
+    solution.search_count = search_count;
+    solution.backtrack_count = backtrack_count;
+    solutions.push_back(solution);
+    return;
+  }
+  if (sink) {
+    // Variables decided before the search keep their values.
+    if (!sink_values) {
+      for (auto *list : {&variables, &decided})
+        for (auto *variable : *list)
+          num_sink_values = max(num_sink_values, variable->GetId() + 1);
+      sink_values.reset(new T[num_sink_values]());
+      for (auto *variable : decided)
+        sink_values[variable->GetId()] = variable->GetValue(0);
+    }
+    for (auto *variable : variables)
+      sink_values[variable->GetId()] = variable->GetValue(0);
+    sink->OnSolution(sink_values.get(), num_sink_values);
+    return;
+  }
+  printf(
+      "----- Solution %ld after %ld searches, %ld backtracks and %.3fs -----\n",
+      num_solutions, search_count, backtrack_count, GetTimeUsage());
+  ShowSolution();
+  if (option.optimize) ShowGap();
+}
+
+template <class T>
+void Problem<T>::SetSink(SolutionSink<T> *sink_in) {
+  delete sink;
+  sink = sink_in;
+}
+
+// Make the sink of the output option unless one has been set. False is
+// returned if the output file cannot be opened. Binary solutions would be
+// interleaved with the statistics on stdout, so they need a file.
+template <class T>
+bool Problem<T>::OpenSink() {
+  if (sink || option.output == Option::OUTPUT_SHOW) return true;
+  if (option.output == Option::OUTPUT_BINARY && !option.output_file) {
+    printf("Binary output requires an output file\n");
+    return false;
+  }
+  FILE *file = stdout;
+  if (option.output_file && option.output != Option::OUTPUT_COUNT) {
+    file = sink_file = fopen(option.output_file, "w");
+    if (!file) {
+      printf("Cannot open output file %s\n", option.output_file);
+      return false;
+    }
+  }
+  switch (option.output) {
+    case Option::OUTPUT_TEXT:
+      sink = new TextSink<T>(file, Format, this);
+      break;
+    case Option::OUTPUT_BINARY:
+      sink = new BinarySink<T>(file);
+      break;
+    default:
+      sink = new CountingSink<T>();
+      break;
+  }
+  return true;
+}
+
+template <class T>
+void Problem<T>::Format(void *problem, const T values[], size_t count,
+                        string *text) {
+  static_cast<Problem<T> *>(problem)->FormatSolution(values, count, text);
+}
+
+// Values separated by spaces on a line.
+template <class T>
+void Problem<T>::FormatSolution(const T values[], size_t count,
+                                string *text) {
+  for (size_t i = 0; i < count; i++) {
+    if (i > 0) *text += ' ';
+    *text += to_string(values[i]);
+  }
+  *text += '\n';
+}
+
 template <class T>
 void Problem<T>::IncrementCounter(size_t index, size_t inc) {
   counters[index].value += inc;
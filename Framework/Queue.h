@@ -4,6 +4,7 @@
 class QueueObject {
  public:
   QueueObject() : prev(NULL), next(NULL), in_queue(false) {}
+  QueueObject(const QueueObject&) : QueueObject() {}
 
  private:
   template<typename T> friend class Queue;
@@ -62,4 +63,38 @@ bool Queue<T>::IsEmpty() const {
   return (head == NULL);
 }
 
+//
+// A queue with N levels of priority. Objects are dequeued from the lowest
+// level that is not empty and in FIFO order within a level.
+//
+template <typename T, size_t N>
+class PriorityQueue {
+ public:
+  void Enqueue(QueueObject* obj, size_t level);
+  T Dequeue();
+  bool IsEmpty() const;
+
+ private:
+  Queue<T> levels[N];
+};
+
+template <typename T, size_t N>
+void PriorityQueue<T, N>::Enqueue(QueueObject* obj, size_t level) {
+  levels[level].Enqueue(obj);
+}
+
+template <typename T, size_t N>
+T PriorityQueue<T, N>::Dequeue() {
+  size_t level = 0;
+  while (levels[level].IsEmpty()) level++;
+  return levels[level].Dequeue();
+}
+
+template <typename T, size_t N>
+bool PriorityQueue<T, N>::IsEmpty() const {
+  for (size_t level = 0; level < N; level++)
+    if (!levels[level].IsEmpty()) return false;
+  return true;
+}
+
 #endif
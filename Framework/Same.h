@@ -10,6 +10,7 @@ template <class T>
 class Same : public Constraint<T> {
  public:
   bool OnDecided(Variable<T> *decided);
+  Constraint<T> *Clone() const { return new Same<T>(*this); }
 
  private:
 };
@@ -0,0 +1,93 @@
+#ifndef SOLUTION_SINK_H
+#define SOLUTION_SINK_H
+
+#include <stdio.h>
+#include <string>
+using namespace std;
+
+//
+// A solution sink receives the solutions of a problem as arrays of values by
+// variable id, in place of showing them.
+//
+template <class T>
+class SolutionSink {
+ public:
+  virtual ~SolutionSink() = default;
+
+  virtual void OnSolution(const T values[], size_t count) = 0;
+  // Write out what has been buffered, at the end of the search.
+  virtual void Flush() {}
+};
+
+//
+// TextSink: Format solutions into a buffer that is written to a file when it
+// is full.
+//
+template <class T>
+class TextSink : public SolutionSink<T> {
+ public:
+  typedef void (*Formatter)(void *cookie, const T values[], size_t count,
+                            string *text);
+
+  TextSink(FILE *file, Formatter format_fn, void *cookie)
+      : file(file), format_fn(format_fn), cookie(cookie) {}
+  ~TextSink() { Flush(); }
+
+  void OnSolution(const T values[], size_t count);
+  void Flush();
+
+ private:
+  static const size_t BUFFER_SIZE = 1 << 16;
+
+  FILE *file;
+  Formatter format_fn;
+  void *cookie;
+  string buffer;
+};
+
+template <class T>
+void TextSink<T>::OnSolution(const T values[], size_t count) {
+  format_fn(cookie, values, count, &buffer);
+  if (buffer.size() >= BUFFER_SIZE) Flush();
+}
+
+template <class T>
+void TextSink<T>::Flush() {
+  fwrite(buffer.data(), 1, buffer.size(), file);
+  fflush(file);
+  buffer.clear();
+}
+
+//
+// BinarySink: Write the values of each solution as they are in memory.
+//
+template <class T>
+class BinarySink : public SolutionSink<T> {
+ public:
+  BinarySink(FILE *file) : file(file) {}
+
+  void OnSolution(const T values[], size_t count) {
+    fwrite(values, sizeof(T), count, file);
+  }
+  void Flush() { fflush(file); }
+
+ private:
+  FILE *file;
+};
+
+//
+// CountingSink: Only count the solutions.
+//
+template <class T>
+class CountingSink : public SolutionSink<T> {
+ public:
+  CountingSink() : count(0) {}
+
+  void OnSolution(const T values[], size_t count) { this->count++; }
+  void Flush() { printf("Total solutions: %lu\n", count); }
+
+ private:
+  size_t count;
+};
+
+#endif
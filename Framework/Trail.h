@@ -0,0 +1,479 @@
+#ifndef TRAIL_H
+#define TRAIL_H
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <vector>
+using namespace std;
+
+template <class T>
+class Variable;
+
+template <class T>
+class Constraint;
+
+template <class T>
+struct Literal;
+
+//
+// A trail saves domain counts of variables so they can be restored when the
+// search backtracks to a checkpoint.
+//
+// Every checkpoint has a unique stamp and each variable remembers the stamp
+// of its last save. A variable is saved at most once per checkpoint, because
+// restoring its first saved count undoes all later updates.
+//
+// For conflict-directed backjumping, the trail can also record an event for
+// every update of a domain with the reason of the update: a decision at some
+// level, a constraint that propagated earlier events of its variables, or
+// the levels of decisions given as an explanation. The levels of decisions
+// that a conflict depends on are found by following the reasons back.
+//
+// For nogood learning, the events are also the nodes of an implication graph.
+// The literal of an event is that the variable is the value it was decided
+// to, or is not the value it excluded. Constraints explain the literals they
+// have propagated, and a nogood is found by 1-UIP conflict analysis.
+//
+template <class T>
+class Trail {
+ public:
+  Trail();
+
+  // Save the domain count of a variable unless it is saved already.
+  void Save(Variable<T> *variable, size_t count, size_t &saved_stamp);
+
+  void StartCheckpoint();
+  void RestoreCheckpoint();
+  // Stamps identify checkpoints and are never reused. The root's is 0.
+  size_t GetStamp() const { return stamp; }
+  // The variables saved since the last checkpoint.
+  void GetSavedVariables(vector<Variable<T> *> *variables) const;
+
+  // Forget all saved counts, e.g. before the search starts or restarts.
+  void Clear();
+
+  // Events of updates.
+  static Constraint<T> *const DECISION;
+  static Constraint<T> *const EXPLAINED;
+  void EnableEvents() { events_enabled = true; }
+  void Record(Variable<T> *variable, size_t count, bool assigned);
+  void SetLevel(size_t level_in) { level = level_in; }
+  size_t GetLevel() const { return level; }
+  Constraint<T> *SetReason(Constraint<T> *reason);
+  void SetExplanation(const vector<size_t> &levels);
+
+  // Find the levels of decisions that the conflict of a constraint, or the
+  // wipeout of a variable, depends on. All levels are given if both are NULL.
+  void GetConflictLevels(Constraint<T> *constraint, Variable<T> *variable,
+                         vector<size_t> *levels);
+
+  // Find a nogood that caused the conflict of a constraint, or the wipeout of
+  // a variable. It has a single literal at the latest level, the first unique
+  // implication point, unless decisions at the level are explained only by
+  // their levels. The LBD of the nogood is the number of levels of its
+  // literals. False is returned if the conflict is unknown.
+  bool Analyze(Constraint<T> *constraint, Variable<T> *variable,
+               vector<Literal<T>> *nogood, size_t *lbd);
+
+  size_t GetNumSaved() const { return num_saved; }
+  size_t GetNumSkipped() const { return num_skipped; }
+  size_t GetMaxSize() const { return max_size; }
+  size_t GetMemoryUsage() const;  // in kilo-bytes
+  void AddStatistics(const Trail<T> &trail);
+
+ private:
+  struct Entry {
+    Variable<T> *variable;  // NULL for a checkpoint
+    size_t count;
+    size_t stamp;  // previous stamp of the variable or the checkpoint
+  };
+  vector<Entry> entries;
+  size_t stamp;       // of the current checkpoint, 0 at root
+  size_t next_stamp;  // stamps are never reused
+
+  static const size_t NONE = (size_t)-1;
+  struct Event {
+    Variable<T> *variable;
+    Constraint<T> *reason;  // DECISION, EXPLAINED or NULL if unknown
+    size_t level;
+    size_t previous;        // event of the same variable, NONE if first
+    size_t from;            // domain count before the update
+    size_t to;              // domain count after the update
+    bool assigned;          // decided to a value, or else excluded a value
+    vector<size_t> levels;  // explanation of an EXPLAINED event
+  };
+  void Mark(size_t level);
+
+  // Steps of Analyze.
+  bool HasLiteral(const Event &event) const;
+  Literal<T> GetLiteral(const Event &event) const;
+  bool Explain(size_t index);
+  bool ExplainLevel(size_t level);
+  void See(size_t index);
+  void SeeAll(Variable<T> *variable, size_t end);
+  bool SeeLiteral(const Literal<T> &literal, size_t end);
+
+  bool events_enabled;
+  vector<Event> events;
+  vector<size_t> last_events;  // by variable id, NONE if no events
+  size_t level;                // of the latest decision
+  Constraint<T> *reason;       // of updates being made
+  vector<size_t> explanation;  // of updates being made if EXPLAINED
+
+  // State of GetConflictLevels.
+  vector<bool> marked;  // levels found
+  size_t num_seen;      // seen events not replaced by their reasons
+
+  // State of Analyze.
+  vector<size_t> decisions;  // events of decisions by level
+  vector<bool> seen;         // events that the conflict depends on
+  size_t num_open;           // seen events at the latest level
+  vector<Literal<T>> reason_literals;
+
+  size_t num_saved;
+  size_t num_skipped;
+  size_t max_size;
+};
+
+template <class T>
+Constraint<T> *const Trail<T>::DECISION = (Constraint<T> *)0x1;
+
+template <class T>
+Constraint<T> *const Trail<T>::EXPLAINED = (Constraint<T> *)0x2;
+
+template <class T>
+const size_t Trail<T>::NONE;
+
+template <class T>
+Trail<T>::Trail()
+    : stamp(0),
+      next_stamp(1),
+      events_enabled(false),
+      level(0),
+      reason(NULL),
+      num_seen(0),
+      num_open(0),
+      num_saved(0),
+      num_skipped(0),
+      max_size(0) {}
+
+template <class T>
+void Trail<T>::Save(Variable<T> *variable, size_t count, size_t &saved_stamp) {
+  if (saved_stamp == stamp) {
+    num_skipped++;
+    return;
+  }
+  entries.push_back(Entry{variable, count, saved_stamp});
+  saved_stamp = stamp;
+  num_saved++;
+  max_size = max(max_size, entries.size());
+}
+
+template <class T>
+void Trail<T>::StartCheckpoint() {
+  entries.push_back(Entry{NULL, events.size(), stamp});
+  stamp = next_stamp++;
+  max_size = max(max_size, entries.size());
+}
+
+template <class T>
+void Trail<T>::RestoreCheckpoint() {
+  for (;;) {
+    Entry &entry = entries.back();
+    if (entry.variable) {
+      entry.variable->Restore(entry.count, entry.stamp);
+      entries.pop_back();
+    } else {
+      stamp = entry.stamp;
+      while (events.size() > entry.count) {
+        const Event &event = events.back();
+        last_events[event.variable->GetId()] = event.previous;
+        events.pop_back();
+      }
+      entries.pop_back();
+      break;
+    }
+  }
+}
+
+template <class T>
+void Trail<T>::GetSavedVariables(vector<Variable<T> *> *variables) const {
+  variables->clear();
+  for (size_t i = entries.size(); i > 0 && entries[i - 1].variable; i--)
+    variables->push_back(entries[i - 1].variable);
+}
+
+template <class T>
+void Trail<T>::Clear() {
+  entries.clear();
+  stamp = 0;
+  events.clear();
+  last_events.assign(last_events.size(), NONE);
+  level = 0;
+  reason = NULL;
+}
+
+// Record an update after a domain has been reduced from the count.
+template <class T>
+void Trail<T>::Record(Variable<T> *variable, size_t count, bool assigned) {
+  if (!events_enabled) return;
+  size_t id = variable->GetId();
+  if (id >= last_events.size()) last_events.resize(id + 1, NONE);
+  events.push_back(Event{variable, reason, level, last_events[id], count,
+                         variable->GetDomainSize(), assigned,
+                         reason == EXPLAINED ? explanation : vector<size_t>()});
+  last_events[id] = events.size() - 1;
+  if (reason == DECISION) {
+    if (level >= decisions.size()) decisions.resize(level + 1, NONE);
+    decisions[level] = events.size() - 1;
+  }
+}
+
+// Set the reason of the following updates and return the previous one.
+template <class T>
+Constraint<T> *Trail<T>::SetReason(Constraint<T> *reason_in) {
+  Constraint<T> *previous = reason;
+  reason = reason_in;
+  return previous;
+}
+
+// Explain the following updates by the given levels of decisions.
+template <class T>
+void Trail<T>::SetExplanation(const vector<size_t> &levels) {
+  reason = EXPLAINED;
+  explanation = levels;
+}
+
+// Events are explained by the literals of their reasons when the reasons
+// can tell them, as in Analyze, and otherwise by all the events of the
+// variables of their reasons.
+template <class T>
+void Trail<T>::GetConflictLevels(Constraint<T> *constraint,
+                                 Variable<T> *variable,
+                                 vector<size_t> *levels) {
+  marked.assign(level + 1, false);
+  seen.assign(events.size(), false);
+  num_open = 0;
+  num_seen = 0;
+  if (constraint) {
+    reason_literals.clear();
+    bool explained = constraint->ExplainConflict(&reason_literals);
+    for (size_t i = 0; explained && i < reason_literals.size(); i++)
+      explained = SeeLiteral(reason_literals[i], events.size());
+    if (!explained) {
+      for (auto *v : constraint->GetVariables()) SeeAll(v, events.size());
+    }
+  } else if (variable) {
+    SeeAll(variable, events.size());
+  } else {
+    for (size_t l = 1; l <= level; l++) marked[l] = true;
+  }
+
+  // Replace the seen events by their reasons, latest first, until only
+  // decisions and explanations by levels are left.
+  for (size_t i = events.size(); i-- > 0 && num_seen > 0;) {
+    if (!seen[i]) continue;
+    num_seen--;
+    const Event &event = events[i];
+    if (event.reason == DECISION) {
+      Mark(event.level);
+    } else if (event.reason == EXPLAINED) {
+      for (size_t l : event.levels) Mark(l);
+    } else if (event.reason == NULL) {
+      for (size_t l = 1; l <= event.level; l++) Mark(l);
+    } else {
+      reason_literals.clear();
+      bool explained =
+          HasLiteral(event) &&
+          event.reason->Explain(GetLiteral(event), &reason_literals);
+      for (size_t j = 0; explained && j < reason_literals.size(); j++)
+        explained = SeeLiteral(reason_literals[j], i);
+      if (!explained) {
+        for (auto *v : event.reason->GetVariables()) SeeAll(v, i);
+      }
+    }
+  }
+
+  levels->clear();
+  for (size_t l = 1; l <= level; l++)
+    if (marked[l]) levels->push_back(l);
+}
+
+template <class T>
+void Trail<T>::Mark(size_t l) {
+  if (l < marked.size()) marked[l] = true;
+}
+
+template <class T>
+bool Trail<T>::Analyze(Constraint<T> *constraint, Variable<T> *variable,
+                       vector<Literal<T>> *nogood, size_t *lbd) {
+  nogood->clear();
+  if (!constraint && !variable) return false;
+  seen.assign(events.size(), false);
+  num_open = 0;
+  if (constraint) {
+    reason_literals.clear();
+    bool explained = constraint->ExplainConflict(&reason_literals);
+    for (size_t i = 0; explained && i < reason_literals.size(); i++)
+      explained = SeeLiteral(reason_literals[i], events.size());
+    if (!explained) {
+      for (auto *v : constraint->GetVariables()) SeeAll(v, events.size());
+    }
+  } else {
+    SeeAll(variable, events.size());
+  }
+
+  // Replace the latest events by their reasons until one is left at the
+  // latest level. Decisions are kept as they are.
+  for (size_t i = events.size(); i-- > 0 && num_open > 0;) {
+    const Event &event = events[i];
+    if (!seen[i] || event.level != level) continue;
+    if (num_open == 1 && HasLiteral(event)) break;
+    num_open--;
+    if (event.reason == DECISION) continue;
+    seen[i] = false;
+    if (!Explain(i)) return false;
+  }
+
+  marked.assign(level + 1, false);
+  *lbd = 0;
+  for (size_t i = 0; i < events.size(); i++) {
+    if (!seen[i]) continue;
+    nogood->push_back(GetLiteral(events[i]));
+    if (!marked[events[i].level]) {
+      marked[events[i].level] = true;
+      ++*lbd;
+    }
+  }
+  return true;
+}
+
+// An event has no literal if a variable is decided to an excluded value.
+template <class T>
+bool Trail<T>::HasLiteral(const Event &event) const {
+  return !event.assigned || event.to > 0;
+}
+
+template <class T>
+Literal<T> Trail<T>::GetLiteral(const Event &event) const {
+  Variable<T> *variable = event.variable;
+  if (event.assigned) return Literal<T>{variable, variable->GetValue(0), true};
+  return Literal<T>{variable, variable->GetValue(event.to), false};
+}
+
+// See the events that the index-th event is implied by.
+template <class T>
+bool Trail<T>::Explain(size_t index) {
+  const Event &event = events[index];
+  if (event.reason == EXPLAINED) {
+    for (size_t l : event.levels)
+      if (!ExplainLevel(l)) return false;
+  } else if (event.reason == NULL) {
+    for (size_t l = 1; l <= event.level; l++)
+      if (!ExplainLevel(l)) return false;
+  } else {
+    reason_literals.clear();
+    bool explained =
+        HasLiteral(event) &&
+        event.reason->Explain(GetLiteral(event), &reason_literals);
+    for (size_t i = 0; explained && i < reason_literals.size(); i++)
+      explained = SeeLiteral(reason_literals[i], index);
+    if (!explained) {
+      for (auto *v : event.reason->GetVariables()) SeeAll(v, index);
+    }
+  }
+  return true;
+}
+
+// See the decision at a level. False is returned if it is unknown.
+template <class T>
+bool Trail<T>::ExplainLevel(size_t l) {
+  if (l >= decisions.size()) return false;
+  size_t index = decisions[l];
+  if (index >= events.size() || events[index].reason != DECISION ||
+      events[index].level != l)
+    return false;
+  See(index);
+  return true;
+}
+
+// Events at level 0 are facts that don't depend on any decision.
+template <class T>
+void Trail<T>::See(size_t index) {
+  if (seen[index] || events[index].level == 0) return;
+  seen[index] = true;
+  num_seen++;
+  if (events[index].level == level) num_open++;
+}
+
+// See the events of a variable before the end.
+template <class T>
+void Trail<T>::SeeAll(Variable<T> *variable, size_t end) {
+  size_t id = variable->GetId();
+  if (id >= last_events.size()) return;
+  for (size_t i = last_events[id]; i != NONE; i = events[i].previous)
+    if (i < end) See(i);
+}
+
+// See the events that made a literal true before the end. False is returned
+// if it wasn't true then.
+template <class T>
+bool Trail<T>::SeeLiteral(const Literal<T> &literal, size_t end) {
+  Variable<T> *variable = literal.variable;
+  size_t id = variable->GetId();
+  size_t first = NONE;  // of the variable
+  size_t last = NONE;   // of the variable before the end
+  if (id < last_events.size()) {
+    for (size_t i = last_events[id]; i != NONE; i = events[i].previous) {
+      if (i < end && last == NONE) last = i;
+      first = i;
+    }
+  }
+
+  // Count and positions of the values before any event of the variable.
+  size_t count = first == NONE ? variable->GetDomainSize() : events[first].from;
+  if (literal.is) {
+    if (last == NONE)
+      return count == 1 && variable->GetValue(0) == literal.value;
+    if (events[last].to != 1 || variable->GetValue(0) != literal.value)
+      return false;
+    // The variable is the value since its domain was reduced to one value.
+    size_t i = last;
+    while (events[i].previous != NONE && events[events[i].previous].to == 1)
+      i = events[i].previous;
+    if (events[i].assigned) {
+      See(i);
+    } else {
+      SeeAll(variable, i + 1);
+    }
+    return true;
+  }
+
+  for (size_t i = last; i != NONE; i = events[i].previous) {
+    for (size_t p = events[i].to; p < events[i].from; p++) {
+      if (variable->GetValue(p) == literal.value) {
+        See(i);
+        return true;
+      }
+    }
+  }
+  for (size_t p = 0; p < count; p++)
+    if (variable->GetValue(p) == literal.value) return false;
+  return true;
+}
+
+template <class T>
+size_t Trail<T>::GetMemoryUsage() const {
+  return (entries.size() * sizeof(Entry) + events.size() * sizeof(Event)) /
+         1024;
+}
+
+template <class T>
+void Trail<T>::AddStatistics(const Trail<T> &trail) {
+  num_saved += trail.num_saved;
+  num_skipped += trail.num_skipped;
+  max_size = max(max_size, trail.max_size);
+}
+
+#endif
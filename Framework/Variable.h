@@ -2,6 +2,8 @@
 #define VARIABLE_H
 
 #include "Domain.h"
+#include "Trail.h"
+#include "VariableHeap.h"
 
 #include <stdio.h>
 #include <set>
@@ -18,6 +20,7 @@ class Variable {
   Variable(const T value[]);
   Variable(const T value[], size_t count);
   Variable(bool (*generator_fn)(void *, T &), void *cookie);
+  Variable(const Variable<T> &variable);  // copy without constraints
   void Init();
 
   void SetName(const char *name);
@@ -26,8 +29,10 @@ class Variable {
   size_t GetId() const;
 
   void AddConstraint(Constraint<T> *constraint);
+  void Watch(Constraint<T> *constraint, int events);
   bool PropagateDecision(Constraint<T> *start);
   bool PropagateReduction(Constraint<T> *start);
+  bool PropagateBounds(Constraint<T> *start);
   void ActivateAffectedVariables();
   void GetDecidedValuesInSameContraints(set<T> *values);
 
@@ -44,17 +49,24 @@ class Variable {
   size_t GetDomainSize() const;
   const Domain<T> &GetDomain() const;
   size_t GetNumConstraints() const { return constraints.size(); }
+  const vector<Constraint<T> *> &GetConstraints() const { return constraints; }
+  float GetWeightedDegree() const;
   void ShowDomain() const;
 
-  typedef vector<pair<Variable<T> *, size_t> > Storage;
-  void SetStorage(Storage *storage);
+  void SetTrail(Trail<T> *trail);
+  void SetHeap(VariableHeap<T> *heap);
   void Checkpoint();
-  void Restore(size_t count);
+  void Restore(size_t count, size_t stamp);
 
  private:
   Domain<T> domain;
   vector<Constraint<T> *> constraints;
-  Storage *storage;
+  vector<Constraint<T> *> decided_watchers;  // notified when decided
+  vector<Constraint<T> *> reduced_watchers;  // notified when reduced
+  vector<Constraint<T> *> bounds_watchers;   // notified when bounds change
+  Trail<T> *trail;
+  size_t saved_stamp;  // of the checkpoint when the domain was last saved
+  VariableHeap<T> *heap;
   const char *name;
   size_t id;
 
@@ -69,31 +81,40 @@ class Variable {
 
 template <class T>
 Variable<T>::Variable(T low, T high)
-    : domain(low, high), name("") {
+    : domain(low, high), heap(NULL), name("") {
   Init();
 }
 
 template <class T>
 Variable<T>::Variable(const T value[])
-    : domain(value), name("") {
+    : domain(value), heap(NULL), name("") {
   Init();
 }
 
 template <class T>
 Variable<T>::Variable(const T value[], size_t count)
-    : domain(value, count), name("") {
+    : domain(value, count), heap(NULL), name("") {
   Init();
 }
 
 template <class T>
 Variable<T>::Variable(bool (*generator_fn)(void *, T &), void *cookie)
-    : domain(generator_fn, cookie), name("") {
+    : domain(generator_fn, cookie), heap(NULL), name("") {
   Init();
 }
 
+template <class T>
+Variable<T>::Variable(const Variable<T> &variable)
+    : domain(variable.domain), trail(NULL), heap(NULL), id(variable.id) {
+  Init();
+  name = variable.name;
+  failures = variable.failures;
+}
+
 template <class T>
 void Variable<T>::Init() {
   name = "";
+  saved_stamp = 0;
   failures = 0;
   deadends = 0;
   active = false;
@@ -124,24 +145,63 @@ void Variable<T>::AddConstraint(Constraint<T> *constraint) {
   constraints.push_back(constraint);
 }
 
+// Subscribe a constraint to the events of the variable.
 template <class T>
-bool Variable<T>::PropagateDecision(Constraint<T> *start) {
-  for (size_t i = 0; i < constraints.size(); i++) {
-    if (constraints[i] == start) continue;
+void Variable<T>::Watch(Constraint<T> *constraint, int events) {
+  if (events & Constraint<T>::DECIDED) decided_watchers.push_back(constraint);
+  if (events & Constraint<T>::REDUCED)
+    reduced_watchers.push_back(constraint);
+  else if (events & Constraint<T>::BOUNDS)
+    bounds_watchers.push_back(constraint);
+}
 
-    bool consistent = constraints[i]->OnDecided(this);
-    if (!consistent) return false;
+template <class T>
+bool Variable<T>::PropagateDecision(Constraint<T> *start) {
+  for (size_t i = 0; i < decided_watchers.size(); i++) {
+    Constraint<T> *constraint = decided_watchers[i];
+    if (constraint == start) continue;
+
+    Constraint<T> *reason = trail->SetReason(constraint);
+    bool consistent = constraint->OnDecided(this);
+    trail->SetReason(reason);
+    if (!consistent) {
+      constraint->ReportConflict();
+      return false;
+    }
   }
   return true;
 }
 
 template <class T>
 bool Variable<T>::PropagateReduction(Constraint<T> *start) {
-  for (size_t i = 0; i < constraints.size(); i++) {
-    if (constraints[i] == start) continue;
+  for (size_t i = 0; i < reduced_watchers.size(); i++) {
+    Constraint<T> *constraint = reduced_watchers[i];
+    if (constraint == start) continue;
+
+    Constraint<T> *reason = trail->SetReason(constraint);
+    bool consistent = constraint->OnReduced(this);
+    trail->SetReason(reason);
+    if (!consistent) {
+      constraint->ReportConflict();
+      return false;
+    }
+  }
+  return true;
+}
 
-    bool consistent = constraints[i]->OnReduced(this);
-    if (!consistent) return false;
+template <class T>
+bool Variable<T>::PropagateBounds(Constraint<T> *start) {
+  for (size_t i = 0; i < bounds_watchers.size(); i++) {
+    Constraint<T> *constraint = bounds_watchers[i];
+    if (constraint == start) continue;
+
+    Constraint<T> *reason = trail->SetReason(constraint);
+    bool consistent = constraint->OnReduced(this);
+    trail->SetReason(reason);
+    if (!consistent) {
+      constraint->ReportConflict();
+      return false;
+    }
   }
   return true;
 }
@@ -168,6 +228,8 @@ bool Variable<T>::Decide(T value, Constraint<T> *constraint) {
   OnUpdate();
   auto old_domain_size = domain.GetSize();
   domain.LimitBounds(value, value);
+  trail->Record(this, old_domain_size, true);
+  if (heap) heap->Update(this);
   auto new_domain_size = domain.GetSize();
   if (old_domain_size > 1 && new_domain_size == 1)
     return PropagateDecision(constraint);
@@ -183,8 +245,13 @@ bool Variable<T>::Exclude(T value, Constraint<T> *constraint) {
       return false;
     else if (domain.GetSize() == 1)
       return PropagateDecision(constraint);
-    else
-      return PropagateReduction(constraint);
+    else if (!PropagateReduction(constraint))
+      return false;
+    if (!bounds_watchers.empty()) {
+      T low, high;
+      domain.GetBounds(low, high);
+      if (value < low || value > high) return PropagateBounds(constraint);
+    }
   }
   return true;
 }
@@ -192,7 +259,10 @@ bool Variable<T>::Exclude(T value, Constraint<T> *constraint) {
 template <class T>
 bool Variable<T>::Decide(T value) {
   OnUpdate();
+  size_t old_domain_size = domain.GetSize();
   domain.LimitBounds(value, value);
+  trail->Record(this, old_domain_size, true);
+  if (heap) heap->Update(this);
   return domain.GetSize() > 0;
 }
 
@@ -209,6 +279,8 @@ template <class T>
 void Variable<T>::ExcludeAt(size_t i) {
   OnUpdate();
   domain.EraseValueAt(i);
+  trail->Record(this, domain.GetSize() + 1, false);
+  if (heap) heap->Update(this);
 }
 
 template <class T>
@@ -236,6 +308,15 @@ const Domain<T> &Variable<T>::GetDomain() const {
   return domain;
 }
 
+// Sum of the weights of constraints with other undecided variables.
+template <class T>
+float Variable<T>::GetWeightedDegree() const {
+  float degree = 0;
+  for (size_t i = 0; i < constraints.size(); i++)
+    if (constraints[i]->IsOpen()) degree += constraints[i]->weight;
+  return degree;
+}
+
 template <class T>
 void Variable<T>::ShowDomain() const {
   printf("Variable %ld = { ", GetId());
@@ -244,18 +325,25 @@ void Variable<T>::ShowDomain() const {
 }
 
 template <class T>
-void Variable<T>::SetStorage(Storage *storage_in) {
-  storage = storage_in;
+void Variable<T>::SetTrail(Trail<T> *trail_in) {
+  trail = trail_in;
+}
+
+template <class T>
+void Variable<T>::SetHeap(VariableHeap<T> *heap_in) {
+  heap = heap_in;
 }
 
 template <class T>
 void Variable<T>::Checkpoint() {
-  storage->push_back(make_pair(this, domain.GetCount()));
+  trail->Save(this, domain.GetCount(), saved_stamp);
 }
 
 template <class T>
-void Variable<T>::Restore(size_t count) {
+void Variable<T>::Restore(size_t count, size_t stamp) {
   domain.SetCount(count);
+  saved_stamp = stamp;
+  if (heap) heap->Update(this);
 }
 
 #endif
@@ -0,0 +1,186 @@
+#ifndef VARIABLE_HEAP_H
+#define VARIABLE_HEAP_H
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <vector>
+using namespace std;
+
+template <class T>
+class Variable;
+
+//
+// A heap selects the next variable to search, as Problem::Sort does with a
+// linear scan. It holds the undecided variables that have not been selected,
+// i.e. those at or after the boundary in the list of variables.
+//
+// Variables update the heap when their domains are reduced or restored, so
+// backtracking puts restored variables back without rescanning the list.
+//
+template <class T>
+class VariableHeap {
+ public:
+  // Is the first variable to be searched before the second?
+  typedef bool (*Compare)(const Variable<T> *, const Variable<T> *);
+
+  VariableHeap(vector<Variable<T> *> &variables, Compare before);
+  ~VariableHeap();
+
+  // Move the best variable to the v-th position and select it.
+  // Variables before the v-th position stay selected.
+  void Select(size_t v);
+
+  // Reorder a variable after its domain or failures have changed.
+  void Update(Variable<T> *variable);
+
+  // Reorder all variables after their failures have changed.
+  void Rebuild();
+
+ private:
+  static const size_t NONE = (size_t)-1;
+
+  bool IsBefore(const Variable<T> *v1, const Variable<T> *v2) const;
+  bool IsCandidate(Variable<T> *variable) const;
+  void Insert(Variable<T> *variable);
+  void Remove(Variable<T> *variable);
+  void Place(size_t i, Variable<T> *variable);
+  void SiftUp(size_t i);
+  void SiftDown(size_t i);
+
+  vector<Variable<T> *> &variables;
+  Compare before;
+  vector<Variable<T> *> heap;
+  vector<size_t> index;     // in the heap by variable id, NONE if absent
+  vector<size_t> position;  // in the list of variables by variable id
+  size_t boundary;          // variables before it are selected
+};
+
+template <class T>
+const size_t VariableHeap<T>::NONE;
+
+template <class T>
+VariableHeap<T>::VariableHeap(vector<Variable<T> *> &variables, Compare before)
+    : variables(variables), before(before), boundary(0) {
+  size_t max_id = 0;
+  for (auto *variable : variables) max_id = max(max_id, variable->GetId());
+  index.resize(max_id + 1, NONE);
+  position.resize(max_id + 1);
+  for (size_t i = 0; i < variables.size(); i++) {
+    position[variables[i]->GetId()] = i;
+    variables[i]->SetHeap(this);
+    if (IsCandidate(variables[i])) Insert(variables[i]);
+  }
+}
+
+template <class T>
+VariableHeap<T>::~VariableHeap() {
+  for (auto *variable : variables) variable->SetHeap(NULL);
+}
+
+template <class T>
+void VariableHeap<T>::Select(size_t v) {
+  for (; boundary < v; boundary++) Remove(variables[boundary]);
+  while (boundary > v) {
+    boundary--;
+    if (IsCandidate(variables[boundary])) Insert(variables[boundary]);
+  }
+  if (heap.empty()) return;
+
+  Variable<T> *best = heap[0];
+  Remove(best);
+  size_t i = position[best->GetId()];
+  swap(variables[v], variables[i]);
+  position[variables[i]->GetId()] = i;
+  position[best->GetId()] = v;
+  boundary = v + 1;
+  if (index[variables[i]->GetId()] != NONE) Update(variables[i]);
+}
+
+template <class T>
+void VariableHeap<T>::Update(Variable<T> *variable) {
+  size_t i = index[variable->GetId()];
+  if (!IsCandidate(variable)) {
+    if (i != NONE) Remove(variable);
+  } else if (i == NONE) {
+    Insert(variable);
+  } else {
+    SiftUp(i);
+    SiftDown(index[variable->GetId()]);
+  }
+}
+
+template <class T>
+void VariableHeap<T>::Rebuild() {
+  for (size_t i = heap.size() / 2; i > 0; i--) SiftDown(i - 1);
+}
+
+// Ties are broken by positions like the linear scan of Problem::Sort.
+template <class T>
+bool VariableHeap<T>::IsBefore(const Variable<T> *v1,
+                               const Variable<T> *v2) const {
+  if (before(v1, v2)) return true;
+  if (before(v2, v1)) return false;
+  return position[v1->GetId()] < position[v2->GetId()];
+}
+
+template <class T>
+bool VariableHeap<T>::IsCandidate(Variable<T> *variable) const {
+  return variable->GetDomainSize() > 1 &&
+         position[variable->GetId()] >= boundary;
+}
+
+template <class T>
+void VariableHeap<T>::Insert(Variable<T> *variable) {
+  heap.push_back(variable);
+  index[variable->GetId()] = heap.size() - 1;
+  SiftUp(heap.size() - 1);
+}
+
+template <class T>
+void VariableHeap<T>::Remove(Variable<T> *variable) {
+  size_t i = index[variable->GetId()];
+  if (i == NONE) return;
+  index[variable->GetId()] = NONE;
+  Variable<T> *last = heap.back();
+  heap.pop_back();
+  if (i == heap.size()) return;
+  Place(i, last);
+  SiftUp(i);
+  SiftDown(index[last->GetId()]);
+}
+
+template <class T>
+void VariableHeap<T>::Place(size_t i, Variable<T> *variable) {
+  heap[i] = variable;
+  index[variable->GetId()] = i;
+}
+
+template <class T>
+void VariableHeap<T>::SiftUp(size_t i) {
+  Variable<T> *variable = heap[i];
+  while (i > 0) {
+    size_t parent = (i - 1) / 2;
+    if (!IsBefore(variable, heap[parent])) break;
+    Place(i, heap[parent]);
+    i = parent;
+  }
+  Place(i, variable);
+}
+
+template <class T>
+void VariableHeap<T>::SiftDown(size_t i) {
+  Variable<T> *variable = heap[i];
+  for (;;) {
+    size_t child = 2 * i + 1;
+    if (child >= heap.size()) break;
+    if (child + 1 < heap.size() && IsBefore(heap[child + 1], heap[child]))
+      child++;
+    if (!IsBefore(heap[child], variable)) break;
+    Place(i, heap[child]);
+    i = child;
+  }
+  Place(i, variable);
+}
+
+#endif
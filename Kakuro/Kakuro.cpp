@@ -10,6 +10,7 @@ class Kakuro : public Problem<int> {
  public:
   Kakuro(Option option);
   void ShowSolution();
+  void FormatSolution(const int values[], size_t count, string *text);
 
  private:
   static const int M = 30;
@@ -129,6 +130,35 @@ void Kakuro::ShowSolution() {
   }
 }
 
+void Kakuro::FormatSolution(const int values[], size_t count,
+                            string *text) {
+  char cell[16];
+  for (int y = 0; y < rows; y++) {
+    for (int x = 0; x < cols; x++) {
+      if (v[x][y]) {
+        snprintf(cell, sizeof(cell), "  %d   ", values[v[x][y]->GetId()]);
+        *text += cell;
+      } else {
+        if (down_sum[x][y] > 0) {
+          snprintf(cell, sizeof(cell), "%2d\\", down_sum[x][y]);
+          *text += cell;
+        } else {
+          *text += "  \\";
+        }
+        if (right_sum[x][y] > 0) {
+          snprintf(cell, sizeof(cell), "%d%s ", right_sum[x][y],
+                   right_sum[x][y] < 10 ? " " : "");
+          *text += cell;
+        } else {
+          *text += "   ";
+        }
+      }
+    }
+    *text += '\n';
+  }
+  *text += '\n';
+}
+
 int main(int argc, char *argv[]) {
   Option option;
   option.sort = Option::SORT_DOMAIN_SIZE;
@@ -52,6 +52,7 @@ class MasterMind : public Problem<int> {
  public:
   MasterMind(Option option, int num_pegs, int num_colors);
   void ShowSolution();
+  void FormatSolution(const int values[], size_t count, string *text);
 
  private:
   int num_pegs;
@@ -109,6 +110,15 @@ void MasterMind::ShowSolution() {
   }
 }
 
+// Codes that are consistent with the guesses so far, as the next guess would
+// be shown.
+void MasterMind::FormatSolution(const int values[], size_t count,
+                                string *text) {
+  for (int i = 0; i < num_pegs; i++)
+    *text += to_string(values[v[i]->GetId()] + 1) + ' ';
+  *text += '\n';
+}
+
 bool MasterMind::Match::operator()(int count, const int values[],
                                    int guess_id) {
   Code &guess = guesses[guess_id];
@@ -15,6 +15,7 @@ class Nonogram : public Problem<char> {
   void ReadLine(char line[], size_t length);
   void ShowState(Variable<char> *);
   void ShowSolution();
+  void FormatSolution(const char values[], size_t count, string *text);
   void ShowCounters();
 
  private:
@@ -133,6 +134,16 @@ void Nonogram::ShowSolution() {
   }
 }
 
+void Nonogram::FormatSolution(const char values[], size_t count,
+                              string *text) {
+  for (int y = 0; y < rows; y++) {
+    for (int x = 0; x < columns; x++)
+      *text += values[grid[x][y].GetId()] ? "O " : ". ";
+    *text += '\n';
+  }
+  *text += '\n';
+}
+
 void Nonogram::ShowCounters() {
   Problem<char>::ShowCounters();
   printf("Hit ratio: %.1f%%\n", 100.0 * counters[1].value / counters[0].value);
@@ -12,6 +12,8 @@ class RunLength : public Constraint<char> {
  public:
   RunLength(vector<int> &length);
   bool Enforce();
+  Cost GetCost() const { return EXPENSIVE; }
+  Constraint<char> *Clone() const { return new RunLength<M, B>(*this); }
 
  private:
   vector<int> &length;
@@ -13,20 +13,19 @@ class Equality : public Constraint<int> {
  public:
   Equality(Variable<int>* n0, Variable<int>* n1, Variable<int>* relation);
   bool Enforce() override;
-
- private:
-  Variable<int>* const n0;
-  Variable<int>* const n1;
-  Variable<int>* const relation;
+  Cost GetCost() const override { return CHEAP; }
+  Constraint<int>* Clone() const override { return new Equality(*this); }
 };
 
 Equality::Equality(Variable<int>* n0, Variable<int>* n1,
-                   Variable<int>* relation)
-    : n0(n0), n1(n1), relation(relation) {
+                   Variable<int>* relation) {
   AddVariable(3, n0, n1, relation);
 }
 
 bool Equality::Enforce() {
+  Variable<int>* n0 = variables[0];
+  Variable<int>* n1 = variables[1];
+  Variable<int>* relation = variables[2];
   bool n0_decided = n0->GetDomainSize() == 1;
   bool n1_decided = n1->GetDomainSize() == 1;
   bool relation_decided = relation->GetDomainSize() == 1;
@@ -59,7 +58,10 @@ class Numberlink : public Problem<int> {
   Numberlink(const Option& option, bool use_alt_format);
   void ShowState(Variable<int>* current) override;
   bool IsValidSolution() override;
+  bool IsDecomposable() const override { return false; }
   void ShowSolution() override;
+  void FormatSolution(const int solution[], size_t count,
+                      string* text) override;
 
  private:
   int rows, columns;
@@ -251,6 +253,42 @@ void Numberlink::ShowSolution() {
   }
 }
 
+void Numberlink::FormatSolution(const int solution[], size_t count,
+                                string* text) {
+  auto value = [&](int r, int c) { return solution[grid[r][c]->GetId()]; };
+  char cell[16];
+  for (int r = 0; r < rows; ++r) {
+    for (int c = 0; c < columns; ++c) {
+      int v = value(r, c);
+      bool same_left = c > 0 && value(r, c - 1) == v;
+      bool same_right = c < columns - 1 && value(r, c + 1) == v;
+      if (values[r][c] > 0) {
+        if (same_left)
+          snprintf(cell, sizeof(cell), v >= 10 ? "--%d" : "---%d", v);
+        else
+          snprintf(cell, sizeof(cell), "%4d", v);
+        *text += cell;
+      } else {
+        if (same_left && same_right)
+          *text += "----";
+        else if (same_left)
+          *text += "---+";
+        else if (same_right)
+          *text += "   +";
+        else
+          *text += "   |";
+      }
+    }
+    *text += '\n';
+    if (r < rows - 1) {
+      for (int c = 0; c < columns; ++c)
+        *text += value(r + 1, c) == value(r, c) ? "   |" : "    ";
+      *text += '\n';
+    }
+  }
+  *text += '\n';
+}
+
 int main(int argc, char* argv[]) {
   Option option;
   option.sort = Option::SORT_DOMAIN_SIZE;
@@ -10,6 +10,7 @@ class Queens : public Problem<int> {
  public:
   Queens(Option option, int size);
   void ShowSolution();
+  void FormatSolution(const int values[], size_t count, string *text);
 
  private:
   int size;
@@ -41,6 +42,17 @@ Queens::Queens(Option option, int size) : Problem<int>(option), size(size) {
       safe->AddVariable(2, v[y1], v[y2]);
       AddConstraint(safe);
     }
+
+  // The board can be flipped vertically, horizontally, or both, i.e. rotated
+  // by 180 degrees. Other rotations and reflections map columns to rows, so
+  // they aren't symmetries of the variables and values.
+  vector<Variable<int> *> rows(v, v + size);
+  vector<Variable<int> *> flipped(rows.rbegin(), rows.rend());
+  map<int, int> mirrored;
+  for (int col = 0; col < size; col++) mirrored[col] = size - 1 - col;
+  AddSymmetry(rows, flipped);
+  AddSymmetry(rows, rows, mirrored);
+  AddSymmetry(rows, flipped, mirrored);
 }
 
 bool Queens::Safe::operator()(int count, const int values[], int distance) {
@@ -56,6 +68,16 @@ void Queens::ShowSolution() {
   }
 }
 
+void Queens::FormatSolution(const int values[], size_t count,
+                            string *text) {
+  for (int row = 0; row < size; row++) {
+    int value = values[v[row]->GetId()];
+    for (int col = 0; col < size; col++) *text += (value == col ? "Q " : ". ");
+    *text += '\n';
+  }
+  *text += '\n';
+}
+
 int main(int argc, char *argv[]) {
   int size = 4;
 
@@ -9,6 +9,7 @@ class Sat : public Problem<bool> {
  public:
   Sat(Option option);
   void ShowSolution();
+  void FormatSolution(const bool values[], size_t count, string *text);
 
  private:
   vector<Variable<bool> *> v;
@@ -41,6 +42,12 @@ void Sat::ShowSolution() {
   puts("");
 }
 
+void Sat::FormatSolution(const bool values[], size_t count, string *text) {
+  for (size_t i = 0; i < v.size(); ++i)
+    if (v[i] && values[v[i]->GetId()]) *text += to_string(i) + ' ';
+  *text += '\n';
+}
+
 int main(int argc, char *argv[]) {
   Option option;
   option.arc_consistency = true;
@@ -9,6 +9,7 @@ class SendMoreMoney : public Problem<int> {
  public:
   SendMoreMoney(Option option);
   void ShowSolution();
+  void FormatSolution(const int values[], size_t count, string *text);
 
  private:
   Variable<int> *s;
@@ -76,6 +77,23 @@ void SendMoreMoney::ShowSolution() {
          n->GetValue(0), e->GetValue(0), y->GetValue(0));
 }
 
+void SendMoreMoney::FormatSolution(const int values[], size_t count,
+                                   string *text) {
+  int s = values[this->s->GetId()], e = values[this->e->GetId()];
+  int n = values[this->n->GetId()], d = values[this->d->GetId()];
+  int m = values[this->m->GetId()], o = values[this->o->GetId()];
+  int r = values[this->r->GetId()], y = values[this->y->GetId()];
+  char line[32];
+  snprintf(line, sizeof(line), "     S=%d E=%d N=%d D=%d\n", s, e, n, d);
+  *text += line;
+  snprintf(line, sizeof(line), " +)  M=%d O=%d R=%d E=%d\n", m, o, r, e);
+  *text += line;
+  *text += "------------------------\n";
+  snprintf(line, sizeof(line), " M=%d O=%d N=%d E=%d Y=%d\n", m, o, n, e, y);
+  *text += line;
+  *text += '\n';
+}
+
 int main(int argc, char *argv[]) {
   Option option;
   option.GetOptions(argc, argv);
@@ -12,6 +12,7 @@ class Strimko : public Problem<int> {
  public:
   Strimko(Option option);
   void ShowSolution();
+  void FormatSolution(const int values[], size_t count, string *text);
 
  private:
   int size;
@@ -139,6 +140,20 @@ void Strimko::ShowSolution() {
   }
 }
 
+void Strimko::FormatSolution(const int values[], size_t count,
+                             string *text) {
+  for (int y = 0; y < size * 2 - 1; y++) {
+    for (int x = 0; x < size * 2 - 1; x++) {
+      if (x % 2 == 0 && y % 2 == 0)
+        *text += '0' + values[v[x / 2][y / 2]->GetId()];
+      else
+        *text += layout[x][y];
+    }
+    *text += '\n';
+  }
+  *text += '\n';
+}
+
 int main(int argc, char *argv[]) {
   Option option;
   option.GetOptions(argc, argv);
@@ -10,6 +10,7 @@ class Sudoku : public Problem<int> {
   Sudoku(Option option);
   void ShowState(Variable<int> *current);
   void ShowSolution();
+  void FormatSolution(const int values[], size_t count, string *text);
 
  private:
   Variable<int> *v[9][9];
@@ -61,6 +62,24 @@ Sudoku::Sudoku(Option option) : Problem<int>(option) {
       AddConstraint(c);
     }
   }
+
+  // Digits that aren't given can be relabeled. Swapping each two of them
+  // that are next to each other keeps the one that appears first smaller.
+  bool given[10] = {false};
+  vector<Variable<int> *> cells;
+  for (int y = 0; y < 9; y++) {
+    for (int x = 0; x < 9; x++) {
+      if (v[x][y]->GetDomainSize() == 1) given[v[x][y]->GetValue(0)] = true;
+      cells.push_back(v[x][y]);
+    }
+  }
+  int previous = 0;
+  for (int digit = 1; digit <= 9; digit++) {
+    if (given[digit]) continue;
+    if (previous)
+      AddSymmetry(cells, cells, {{previous, digit}, {digit, previous}});
+    previous = digit;
+  }
 }
 
 void Sudoku::ShowState(Variable<int> *current) {
@@ -101,6 +120,20 @@ void Sudoku::ShowSolution() {
   putchar('\n');
 }
 
+void Sudoku::FormatSolution(const int values[], size_t count,
+                            string *text) {
+  for (int y = 0; y < 9; y++) {
+    for (int x = 0; x < 9; x++) {
+      int value = values[v[x][y]->GetId()];
+      *text += ' ';
+      *text += value == 0 ? '.' : value + '0';
+      if (x == 2 || x == 5) *text += " |";
+    }
+    *text += y == 2 || y == 5 ? "\n ------+-------+------\n" : "\n";
+  }
+  *text += '\n';
+}
+
 int main(int argc, char *argv[]) {
   Option option;
   option.sort = Option::SORT_DOMAIN_SIZE;
@@ -10,6 +10,7 @@ class Zebra : public Problem<int> {
  public:
   Zebra(Option option);
   void ShowSolution();
+  void FormatSolution(const int values[], size_t count, string *text);
 
  private:
   Variable<int> *v[25];
@@ -174,6 +175,22 @@ void Zebra::ShowSolution() {
   }
 }
 
+void Zebra::FormatSolution(const int values[], size_t count, string *text) {
+  for (int attr = 0; attr < 5; attr++) {
+    Variable<int> *variables[6];
+    for (int i = 0; i < 5; i++)
+      variables[values[v[attr * 5 + i]->GetId()]] = v[attr * 5 + i];
+    for (int house = 1; house <= 5; house++) {
+      char item[32];
+      snprintf(item, sizeof(item), "%12s=%d ", variables[house]->GetName(),
+               house);
+      *text += item;
+    }
+    *text += '\n';
+  }
+  *text += '\n';
+}
+
 int main(int argc, char *argv[]) {
   Option option;
   option.GetOptions(argc, argv);
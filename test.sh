@@ -1,5 +1,28 @@
 #!/bin/sh
 
+FAILURES=0
+
+# Check that a command finds the expected number of solutions.
+check() {
+    EXPECTED=$1
+    shift
+    COUNT=$("$@" | sed -n 's/^\(Total solutions: \|----- Solution \)\([0-9]*\).*/\2/p' | tail -1)
+    if [ "${COUNT:-0}" != "$EXPECTED" ]; then
+        echo "FAILED: $* found ${COUNT:-0} solutions, not $EXPECTED"
+        FAILURES=$((FAILURES + 1))
+    fi
+}
+
+# Check that a command prints the expected line, e.g. a statistic.
+check_line() {
+    EXPECTED=$1
+    shift
+    if ! "$@" | grep -qx "$EXPECTED"; then
+        echo "FAILED: $* did not print: $EXPECTED"
+        FAILURES=$((FAILURES + 1))
+    fi
+}
+
 time Crossword/Crossword
 time SendMoreMoney/SendMoreMoney
 time Zebra/Zebra
@@ -24,3 +47,91 @@ for INPUT in Sat/sat.in[1-9] Sat/unsat.in[1-9]; do
     time Sat/Sat < $INPUT
 done
 
+# A portfolio must find the solutions of the sequential search.
+check 92 Queens/Queens -P 4 -n 0 8
+check 8 Sat/Sat -P 4 -n 0 < Sat/sat.in1
+check 24 Sat/Sat -P 4 -n 0 < Sat/sat.in2
+check 2258 Sat/Sat -P 4 -n 0 < Sat/sat.in3
+check 314 Sat/Sat -P 4 -n 0 < Sat/sat.in4
+check 0 Sat/Sat -P 4 -n 0 < Sat/unsat.in2
+
+# Parallel search must count the solutions of every subtree once.
+check 92 Queens/Queens -j 4 -n 0 8
+check 8 Sat/Sat -j 4 -n 0 < Sat/sat.in1
+check 24 Sat/Sat -j 4 -n 0 < Sat/sat.in2
+check 2258 Sat/Sat -j 4 -n 0 < Sat/sat.in3
+check 314 Sat/Sat -j 4 -n 0 < Sat/sat.in4
+check 18424 Sat/Sat -j 4 -n 0 < Sat/sat.in5
+check 0 Sat/Sat -j 4 -n 0 < Sat/unsat.in2
+
+# Constraints are enforced by cost class, with OneToOne's rebuild deferred to
+# an expensive Enforce. These counts pin the search trees of that order.
+check_line "Total backtracks: 10" Queens/Queens 200 1
+check_line "Total backtracks: 105" Sudoku/Sudoku < Sudoku/sudoku.in1
+check_line "Total backtracks: 610" Sudoku/Sudoku < Sudoku/sudoku.in4
+check_line "Total backtracks: 544" Sudoku/Sudoku < Sudoku/sudoku.in7
+check_line "Total backtracks: 3" Strimko/Strimko < Strimko/strimko.in7
+check_line "Total backtracks: 166" Kakuro/Kakuro < Kakuro/kakuro.in1
+
+# Component backjumping must not skip levels that the cost bound depends on.
+check_line "Optimal cost: 44" Fiver/Fiver -o -a -D -v d 10
+check_line "Optimal cost: 72" Fiver/Fiver -o -D -s w -v d 12
+
+# Replicas share the cost bound, so threads and portfolios find the optimum.
+check_line "Optimal cost: 44" Fiver/Fiver -o 10
+check_line "Optimal cost: 44" Fiver/Fiver -o -j 4 10
+check_line "Optimal cost: 44" Fiver/Fiver -o -P 4 10
+check_line "Optimal cost: 44" Fiver/Fiver -o -a -A 4 10
+
+# Counting multiplies the counts of independent components.
+check 92 Queens/Queens -c 8
+check 8 Sat/Sat -c < Sat/sat.in1
+check 24 Sat/Sat -c < Sat/sat.in2
+check 2258 Sat/Sat -c < Sat/sat.in3
+check 314 Sat/Sat -c < Sat/sat.in4
+check 18424 Sat/Sat -c < Sat/sat.in5
+check 83877812 Sat/Sat -c < Sat/sat.in6
+check 45056 Sat/Sat -c < Sat/sat.in7
+check 112896 Sat/Sat -c < Sat/sat.in8
+for INPUT in Sat/unsat.in[2-8]; do
+    check 0 Sat/Sat -c < $INPUT
+done
+
+# Limited discrepancy search must find each solution once over its passes.
+check 92 Queens/Queens -L 2 -n 0 8
+check 2258 Sat/Sat -L 3 -n 0 < Sat/sat.in3
+check 314 Sat/Sat -L 2 -n 0 < Sat/sat.in4
+check 0 Sat/Sat -L 2 -n 0 < Sat/unsat.in3
+
+# Neighborhoods grow until they cover small models, which proves the optimum.
+check_line "Optimal cost: 44" Fiver/Fiver -o -N 0.05 10
+check_line "Optimal cost: 72" Fiver/Fiver -o -N 0.05 12
+
+# Searches cut off by a resource limit report it instead of UNSAT.
+check_line "Status: LIMIT" Sat/Sat -x 100 < Sat/unsat.in9
+check_line "Status: LIMIT" Sat/Sat -B 10 < Sat/unsat.in9
+check_line "Status: LIMIT" Sat/Sat -T 0.2 -c < Sat/sat.in9
+check_line "Status: LIMIT" Sat/Sat -T 0.5 -j 4 < Sat/unsat.in10
+check_line "Status: LIMIT" Sat/Sat -x 100 -P 4 < Sat/unsat.in9
+
+# Queens declares its mirror images and half turn. Lex-leader constraints keep
+# 24 of the 92 solutions of 8 queens, both when searching and when counting.
+check 24 Queens/Queens -Y -n 0 8
+check 24 Queens/Queens -Y -c 8
+
+# Parallel SAC may exclude fewer values than serial SAC, but no solution.
+check 92 Queens/Queens -a -A 4 -n 0 8
+check 2258 Sat/Sat -A 4 -n 0 < Sat/sat.in3
+check 18424 Sat/Sat -A 4 -n 0 < Sat/sat.in5
+check 0 Sat/Sat -A 4 -n 0 < Sat/unsat.in4
+check 83877812 Sat/Sat -A 4 -c < Sat/sat.in6
+
+# Incremental SAC reuses supports, which must not exclude a solution.
+check 92 Queens/Queens -a -I -n 0 8
+check 2258 Sat/Sat -I -n 0 < Sat/sat.in3
+check 18424 Sat/Sat -I -n 0 < Sat/sat.in5
+check 0 Sat/Sat -I -n 0 < Sat/unsat.in4
+check 314 Sat/Sat -I -A 4 -n 0 < Sat/sat.in4
+check 83877812 Sat/Sat -I -c < Sat/sat.in6
+
+[ $FAILURES -eq 0 ]